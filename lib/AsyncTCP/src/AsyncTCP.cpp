@@ -30,6 +30,7 @@ extern "C"{
 #include "lwip/err.h"
 }
 #include "esp_task_wdt.h"
+#include <atomic>
 
 /*
  * TCP/IP Event Task
@@ -42,6 +43,9 @@ typedef enum {
 typedef struct {
         lwip_event_t event;
         void *arg;
+        uint8_t queue;
+        int8_t slot;
+        uint32_t generation;
         union {
                 struct {
                         void * pcb;
@@ -76,8 +80,17 @@ typedef struct {
         };
 } lwip_event_packet_t;
 
-static xQueueHandle _async_queue;
-static TaskHandle_t _async_service_task_handle = NULL;
+// With CONFIG_ASYNC_TCP_PRIORITY_QUEUE, clients marked high priority get a
+// queue and a service task of their own, so their events are never stuck
+// behind a bulk transfer. Otherwise everything shares queue 0.
+#if CONFIG_ASYNC_TCP_PRIORITY_QUEUE
+const int _number_of_queues = 2;
+#else
+const int _number_of_queues = 1;
+#endif
+const int _async_queue_length = CONFIG_ASYNC_TCP_QUEUE_LENGTH;
+static xQueueHandle _async_queues[_number_of_queues];
+static TaskHandle_t _async_service_task_handles[_number_of_queues];
 
 
 SemaphoreHandle_t _slots_lock;
@@ -92,30 +105,261 @@ static uint32_t _closed_index = []() {
     return 1;
 }();
 
+/*
+ * Event Packet Pool
+ * */
+
+// A packet is either sitting in the queue, being handled by the async task
+// or held by a producer blocked on a full queue; one extra slot per pcb
+// leaves plenty of headroom for the latter.
+// Packets are taken and returned from different tasks, so the pool is a
+// bitmap of used slots updated with CAS instead of a locked free list.
+const int _number_of_event_slots = _number_of_queues * _async_queue_length + CONFIG_LWIP_MAX_ACTIVE_TCP;
+const int _number_of_event_words = (_number_of_event_slots + 31) / 32;
+static lwip_event_packet_t _event_slots[_number_of_event_slots];
+static std::atomic<uint32_t> _event_slots_used[_number_of_event_words];
+static std::atomic<uint32_t> _event_pool_misses(0);
+
+//returns the index of a slot marked as used, or -1 if all of them are taken
+static int _take_pool_slot(std::atomic<uint32_t> * used_words, int slots){
+    for (int w = 0; w < (slots + 31) / 32; ++ w) {
+        uint32_t used = used_words[w].load(std::memory_order_relaxed);
+        while (used != 0xFFFFFFFF) {
+            int bit = __builtin_ctz(~used);
+            if (w * 32 + bit >= slots) {
+                break;
+            }
+            if (used_words[w].compare_exchange_weak(used, used | (1UL << bit), std::memory_order_acquire, std::memory_order_relaxed)) {
+                return w * 32 + bit;
+            }
+        }
+    }
+    return -1;
+}
+
+static void _give_pool_slot(std::atomic<uint32_t> * used_words, int slot){
+    used_words[slot / 32].fetch_and(~(1UL << (slot % 32)), std::memory_order_release);
+}
+
+static lwip_event_packet_t * _alloc_event_packet(){
+    int slot = _take_pool_slot(_event_slots_used, _number_of_event_slots);
+    if (slot >= 0) {
+        return &_event_slots[slot];
+    }
+    //pool exhausted, fall back to the heap
+    _event_pool_misses.fetch_add(1, std::memory_order_relaxed);
+    return (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+}
+
+static void _free_event_packet(lwip_event_packet_t * e){
+    if (e >= _event_slots && e < _event_slots + _number_of_event_slots) {
+        _give_pool_slot(_event_slots_used, e - _event_slots);
+    } else {
+        free((void*)(e));
+    }
+}
+
+uint32_t async_tcp_event_pool_misses(){
+    return _event_pool_misses.load(std::memory_order_relaxed);
+}
+
+/*
+ * Statistics
+ * */
+
+// Always compiled in: a handful of relaxed atomic updates per event is
+// cheap next to the queue round trip that delivered it.
+typedef struct {
+    std::atomic<uint32_t> count;
+    std::atomic<uint32_t> min;
+    std::atomic<uint32_t> max;
+    std::atomic<uint64_t> sum;
+    std::atomic<uint32_t> buckets[ASYNC_TCP_STATS_BUCKETS];
+} async_stats_timing_t;
+
+static std::atomic<uint32_t> _stats_events[ASYNC_TCP_EVENT_TYPES];
+static std::atomic<uint32_t> _stats_events_dropped(0);
+static std::atomic<uint32_t> _stats_queue_depth_max(0);
+static async_stats_timing_t _stats_event_time;
+static async_stats_timing_t _stats_api_call_time;
+
+static void _stats_time(async_stats_timing_t * t, uint32_t us){
+    t->count.fetch_add(1, std::memory_order_relaxed);
+    uint32_t seen = t->min.load(std::memory_order_relaxed);
+    while((seen == 0 || us < seen) && !t->min.compare_exchange_weak(seen, us ? us : 1, std::memory_order_relaxed));
+    seen = t->max.load(std::memory_order_relaxed);
+    while(us > seen && !t->max.compare_exchange_weak(seen, us, std::memory_order_relaxed));
+    t->sum.fetch_add(us, std::memory_order_relaxed);
+    //bucket limits grow by a factor of 4 from 16us, inclusive like Prometheus' le
+    int b = 0;
+    while(b < ASYNC_TCP_STATS_BUCKETS - 1 && us > (16UL << (2 * b))){
+        b++;
+    }
+    t->buckets[b].fetch_add(1, std::memory_order_relaxed);
+}
+
+static void _stats_copy_timing(async_stats_timing_t * from, async_tcp_timing_t * to){
+    to->count = from->count.load(std::memory_order_relaxed);
+    to->min = from->min.load(std::memory_order_relaxed);
+    to->max = from->max.load(std::memory_order_relaxed);
+    to->sum = from->sum.load(std::memory_order_relaxed);
+    for (int i = 0; i < ASYNC_TCP_STATS_BUCKETS; ++ i) {
+        to->buckets[i] = from->buckets[i].load(std::memory_order_relaxed);
+    }
+}
+
+static void _stats_reset_timing(async_stats_timing_t * t){
+    t->count.store(0, std::memory_order_relaxed);
+    t->min.store(0, std::memory_order_relaxed);
+    t->max.store(0, std::memory_order_relaxed);
+    t->sum.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < ASYNC_TCP_STATS_BUCKETS; ++ i) {
+        t->buckets[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+static inline void _stats_queue_depth(xQueueHandle queue){
+    uint32_t depth = uxQueueMessagesWaiting(queue) + 1;
+    uint32_t seen = _stats_queue_depth_max.load(std::memory_order_relaxed);
+    while(depth > seen && !_stats_queue_depth_max.compare_exchange_weak(seen, depth, std::memory_order_relaxed));
+}
+
+void async_tcp_get_stats(async_tcp_stats_t * stats){
+    for (int i = 0; i < ASYNC_TCP_EVENT_TYPES; ++ i) {
+        stats->events[i] = _stats_events[i].load(std::memory_order_relaxed);
+    }
+    stats->events_dropped = _stats_events_dropped.load(std::memory_order_relaxed);
+    _stats_copy_timing(&_stats_event_time, &stats->event_time);
+    _stats_copy_timing(&_stats_api_call_time, &stats->api_call_time);
+    stats->queue_depth = 0;
+    for (int i = 0; i < _number_of_queues; ++ i) {
+        if(_async_queues[i]){
+            stats->queue_depth += uxQueueMessagesWaiting(_async_queues[i]);
+        }
+    }
+    stats->queue_depth_max = _stats_queue_depth_max.load(std::memory_order_relaxed);
+    stats->closed_slots_used = 0;
+    for (int i = 0; i < _number_of_closed_slots; ++ i) {
+        if(_closed_slots[i] == 0){
+            stats->closed_slots_used++;
+        }
+    }
+    stats->event_pool_misses = async_tcp_event_pool_misses();
+    stats->client_pool_misses = async_tcp_client_pool_misses();
+}
+
+void async_tcp_reset_stats(){
+    for (int i = 0; i < ASYNC_TCP_EVENT_TYPES; ++ i) {
+        _stats_events[i].store(0, std::memory_order_relaxed);
+    }
+    _stats_events_dropped.store(0, std::memory_order_relaxed);
+    _stats_queue_depth_max.store(0, std::memory_order_relaxed);
+    _stats_reset_timing(&_stats_event_time);
+    _stats_reset_timing(&_stats_api_call_time);
+}
+
+const char * async_tcp_event_name(int type){
+    static const char * names[ASYNC_TCP_EVENT_TYPES] = {
+        "sent", "recv", "fin", "error", "poll", "clear", "accept", "connected", "dns"
+    };
+    if(type < 0 || type >= ASYNC_TCP_EVENT_TYPES){
+        return "unknown";
+    }
+    return names[type];
+}
+
+/*
+ * Timeout Wheel
+ * */
+
+// Rx and ack timeouts are fired by the async task from a hashed timer wheel,
+// one per queue so a client's timeouts run on the task handling its events.
+// A client sits in the bucket of the tick its earliest timeout could expire
+// at. When that tick comes around the deadline is recomputed from the last
+// rx/tx times, so traffic in between costs nothing; the client is either
+// timed out or moved to the bucket of its new deadline.
+#define ASYNC_TIMER_TICK_MS 125
+#define ASYNC_TIMER_BUCKETS 64
+
+typedef struct {
+    AsyncClient * buckets[ASYNC_TIMER_BUCKETS];
+    uint32_t tick;
+    uint32_t last;
+} async_timer_wheel_t;
+
+static async_timer_wheel_t _timer_wheels[_number_of_queues];
+static portMUX_TYPE _timer_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/*
+ * Event Ownership
+ * */
+
+// Every client owns an event slot for its whole lifetime. Events are tagged
+// with the slot's generation when they are queued; clearing a client's
+// events just moves its slot to a new generation, and anything queued under
+// an older one is dropped when it reaches the front of the queue.
+// Generation 0 marks a free slot.
+const int _number_of_event_owners = CONFIG_LWIP_MAX_ACTIVE_TCP * 2;
+static std::atomic<uint32_t> _event_generations[_number_of_event_owners];
+static std::atomic<uint32_t> _event_generation_counter(0);
+
+static uint32_t _next_event_generation(){
+    uint32_t generation;
+    do {
+        generation = _event_generation_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    } while(generation == 0);
+    return generation;
+}
+
+static inline void _tag_async_event(lwip_event_packet_t * e, int8_t slot, bool high_priority){
+    e->queue = high_priority ? _number_of_queues - 1 : 0;
+    e->slot = slot;
+    e->generation = (slot == -1) ? 0 : _event_generations[slot].load(std::memory_order_acquire);
+}
+
+static inline int8_t _client_event_slot(void * arg){
+    return arg ? reinterpret_cast<AsyncClient*>(arg)->eventSlot() : -1;
+}
+
+static inline bool _client_high_priority(void * arg){
+    return arg ? reinterpret_cast<AsyncClient*>(arg)->getHighPriority() : false;
+}
+
+static inline bool _is_current_async_event(lwip_event_packet_t * e){
+    return e->slot == -1 || _event_generations[e->slot].load(std::memory_order_acquire) == e->generation;
+}
 
 static inline bool _init_async_event_queue(){
-    if(!_async_queue){
-        _async_queue = xQueueCreate(32, sizeof(lwip_event_packet_t *));
-        if(!_async_queue){
-            return false;
+    for (int i = 0; i < _number_of_queues; ++ i) {
+        if(!_async_queues[i]){
+            _async_queues[i] = xQueueCreate(_async_queue_length, sizeof(lwip_event_packet_t *));
+            if(!_async_queues[i]){
+                return false;
+            }
         }
     }
     return true;
 }
 
 static inline bool _send_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueSend(_async_queue, e, portMAX_DELAY) == pdPASS;
+    xQueueHandle queue = _async_queues[(*e)->queue];
+    return queue && xQueueSend(queue, e, portMAX_DELAY) == pdPASS;
 }
 
 static inline bool _prepend_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueSendToFront(_async_queue, e, portMAX_DELAY) == pdPASS;
+    xQueueHandle queue = _async_queues[(*e)->queue];
+    return queue && xQueueSendToFront(queue, e, portMAX_DELAY) == pdPASS;
+}
+
+static inline bool _get_async_event(xQueueHandle queue, lwip_event_packet_t ** e, TickType_t wait){
+    return queue && xQueueReceive(queue, e, wait) == pdPASS;
 }
 
-static inline bool _get_async_event(lwip_event_packet_t ** e){
-    return _async_queue && xQueueReceive(_async_queue, e, portMAX_DELAY) == pdPASS;
+static inline bool _try_get_async_event(xQueueHandle queue, lwip_event_packet_t ** e){
+    return queue && xQueueReceive(queue, e, 0) == pdPASS;
 }
 
-static bool _remove_events_with_arg(void * arg){
+static bool _remove_events_with_arg(xQueueHandle _async_queue, void * arg){
     lwip_event_packet_t * first_packet = NULL;
     lwip_event_packet_t * packet = NULL;
 
@@ -128,8 +372,8 @@ static bool _remove_events_with_arg(void * arg){
             return false;
         }
         //discard packet if matching
-        if((int)first_packet->arg == (int)arg){
-            free(first_packet);
+        if(first_packet->arg == arg){
+            _free_event_packet(first_packet);
             first_packet = NULL;
         //return first packet to the back of the queue
         } else if(xQueueSend(_async_queue, &first_packet, portMAX_DELAY) != pdPASS){
@@ -141,8 +385,8 @@ static bool _remove_events_with_arg(void * arg){
         if(xQueueReceive(_async_queue, &packet, 0) != pdPASS){
             return false;
         }
-        if((int)packet->arg == (int)arg){
-            free(packet);
+        if(packet->arg == arg){
+            _free_event_packet(packet);
             packet = NULL;
         } else if(xQueueSend(_async_queue, &packet, portMAX_DELAY) != pdPASS){
             return false;
@@ -155,8 +399,14 @@ static void _handle_async_event(lwip_event_packet_t * e){
     if(e->arg == NULL){
         // do nothing when arg is NULL
         //ets_printf("event arg == NULL: 0x%08x\n", e->recv.pcb);
+    } else if(!_is_current_async_event(e)){
+        // the client cleared its events after this one was queued
+        _stats_events_dropped.fetch_add(1, std::memory_order_relaxed);
+        if(e->event == LWIP_TCP_RECV && e->recv.pb){
+            pbuf_free(e->recv.pb);
+        }
     } else if(e->event == LWIP_TCP_CLEAR){
-        _remove_events_with_arg(e->arg);
+        _remove_events_with_arg(_async_queues[e->queue], e->arg);
     } else if(e->event == LWIP_TCP_RECV){
         //ets_printf("-R: 0x%08x\n", e->recv.pcb);
         AsyncClient::_s_recv(e->arg, e->recv.pcb, e->recv.pb, e->recv.err);
@@ -182,28 +432,44 @@ static void _handle_async_event(lwip_event_packet_t * e){
         //ets_printf("D: 0x%08x %s = %s\n", e->arg, e->dns.name, ipaddr_ntoa(&e->dns.addr));
         AsyncClient::_s_dns_found(e->dns.name, &e->dns.addr, e->arg);
     }
-    free((void*)(e));
+    _free_event_packet(e);
 }
 
 static void _async_service_task(void *pvParameters){
+    int index = (int)(intptr_t)pvParameters;
+    xQueueHandle queue = _async_queues[index];
     lwip_event_packet_t * packet = NULL;
     for (;;) {
-        if(_get_async_event(&packet)){
+        //wake up at least once per wheel tick to fire the rx/ack timeouts that are due
+        if(_get_async_event(queue, &packet, pdMS_TO_TICKS(ASYNC_TIMER_TICK_MS))){
 #if CONFIG_ASYNC_TCP_USE_WDT
             if(esp_task_wdt_add(NULL) != ESP_OK){
                 log_e("Failed to add async task to WDT");
             }
 #endif
-            _handle_async_event(packet);
+            //drain whatever else is already queued before going back to sleep
+            int handled = 0;
+            _stats_queue_depth(queue);
+            do {
+                lwip_event_t event = packet->event;
+                uint32_t started = micros();
+                _handle_async_event(packet);
+                _stats_time(&_stats_event_time, micros() - started);
+                _stats_events[event].fetch_add(1, std::memory_order_relaxed);
+#if CONFIG_ASYNC_TCP_USE_WDT
+                esp_task_wdt_reset();
+#endif
+            } while(++handled < CONFIG_ASYNC_TCP_EVENT_BATCH && _try_get_async_event(queue, &packet));
 #if CONFIG_ASYNC_TCP_USE_WDT
             if(esp_task_wdt_delete(NULL) != ESP_OK){
                 log_e("Failed to remove loop task from WDT");
             }
 #endif
         }
+        AsyncClient::_s_timeouts(index);
     }
     vTaskDelete(NULL);
-    _async_service_task_handle = NULL;
+    _async_service_task_handles[index] = NULL;
 }
 /*
 static void _stop_async_task(){
@@ -214,13 +480,17 @@ static void _stop_async_task(){
 }
 */
 static bool _start_async_task(){
+    static const char * names[] = { "async_tcp", "async_tcp_hi" };
     if(!_init_async_event_queue()){
         return false;
     }
-    if(!_async_service_task_handle){
-        xTaskCreateUniversal(_async_service_task, "async_tcp", 8192 * 2, NULL, 3, &_async_service_task_handle, CONFIG_ASYNC_TCP_RUNNING_CORE);
-        if(!_async_service_task_handle){
-            return false;
+    for (int i = 0; i < _number_of_queues; ++ i) {
+        if(!_async_service_task_handles[i]){
+            //the high priority task preempts the bulk one as soon as it has work
+            xTaskCreateUniversal(_async_service_task, names[i], 8192 * 2, (void*)(intptr_t)i, 3 + i, &_async_service_task_handles[i], CONFIG_ASYNC_TCP_RUNNING_CORE);
+            if(!_async_service_task_handles[i]){
+                return false;
+            }
         }
     }
     return true;
@@ -231,43 +501,51 @@ static bool _start_async_task(){
  * */
 
 static int8_t _tcp_clear_events(void * arg) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_event_packet();
     e->event = LWIP_TCP_CLEAR;
     e->arg = arg;
+    _tag_async_event(e, -1, _client_high_priority(arg));
     if (!_prepend_async_event(&e)) {
-        free((void*)(e));
+        _free_event_packet(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_connected(void * arg, tcp_pcb * pcb, int8_t err) {
     //ets_printf("+C: 0x%08x\n", pcb);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_event_packet();
     e->event = LWIP_TCP_CONNECTED;
     e->arg = arg;
+    _tag_async_event(e, _client_event_slot(arg), _client_high_priority(arg));
     e->connected.pcb = pcb;
     e->connected.err = err;
     if (!_prepend_async_event(&e)) {
-        free((void*)(e));
+        _free_event_packet(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_poll(void * arg, struct tcp_pcb * pcb) {
     //ets_printf("+P: 0x%08x\n", pcb);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    //timeouts are driven by the timer wheel, only clients with an onPoll handler need the event
+    if(arg && !reinterpret_cast<AsyncClient*>(arg)->wantsPoll()){
+        return ERR_OK;
+    }
+    lwip_event_packet_t * e = _alloc_event_packet();
     e->event = LWIP_TCP_POLL;
     e->arg = arg;
+    _tag_async_event(e, _client_event_slot(arg), _client_high_priority(arg));
     e->poll.pcb = pcb;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_event_packet(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_recv(void * arg, struct tcp_pcb * pcb, struct pbuf *pb, int8_t err) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_event_packet();
     e->arg = arg;
+    _tag_async_event(e, _client_event_slot(arg), _client_high_priority(arg));
     if(pb){
         //ets_printf("+R: 0x%08x\n", pcb);
         e->event = LWIP_TCP_RECV;
@@ -283,40 +561,43 @@ static int8_t _tcp_recv(void * arg, struct tcp_pcb * pcb, struct pbuf *pb, int8_
         AsyncClient::_s_lwip_fin(e->arg, e->fin.pcb, e->fin.err);
     }
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_event_packet(e);
     }
     return ERR_OK;
 }
 
 static int8_t _tcp_sent(void * arg, struct tcp_pcb * pcb, uint16_t len) {
     //ets_printf("+S: 0x%08x\n", pcb);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_event_packet();
     e->event = LWIP_TCP_SENT;
     e->arg = arg;
+    _tag_async_event(e, _client_event_slot(arg), _client_high_priority(arg));
     e->sent.pcb = pcb;
     e->sent.len = len;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_event_packet(e);
     }
     return ERR_OK;
 }
 
 static void _tcp_error(void * arg, int8_t err) {
     //ets_printf("+E: 0x%08x\n", arg);
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_event_packet();
     e->event = LWIP_TCP_ERROR;
     e->arg = arg;
+    _tag_async_event(e, _client_event_slot(arg), _client_high_priority(arg));
     e->error.err = err;
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_event_packet(e);
     }
 }
 
 static void _tcp_dns_found(const char * name, struct ip_addr * ipaddr, void * arg) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_event_packet();
     //ets_printf("+DNS: name=%s ipaddr=0x%08x arg=%x\n", name, ipaddr, arg);
     e->event = LWIP_TCP_DNS;
     e->arg = arg;
+    _tag_async_event(e, _client_event_slot(arg), _client_high_priority(arg));
     e->dns.name = name;
     if (ipaddr) {
         memcpy(&e->dns.addr, ipaddr, sizeof(struct ip_addr));
@@ -324,18 +605,19 @@ static void _tcp_dns_found(const char * name, struct ip_addr * ipaddr, void * ar
         memset(&e->dns.addr, 0, sizeof(e->dns.addr));
     }
     if (!_send_async_event(&e)) {
-        free((void*)(e));
+        _free_event_packet(e);
     }
 }
 
 //Used to switch out from LwIP thread
 static int8_t _tcp_accept(void * arg, AsyncClient * client) {
-    lwip_event_packet_t * e = (lwip_event_packet_t *)malloc(sizeof(lwip_event_packet_t));
+    lwip_event_packet_t * e = _alloc_event_packet();
     e->event = LWIP_TCP_ACCEPT;
     e->arg = arg;
+    _tag_async_event(e, -1, reinterpret_cast<AsyncServer*>(arg)->getHighPriority());
     e->accept.client = client;
     if (!_prepend_async_event(&e)) {
-        free((void*)(e));
+        _free_event_packet(e);
     }
     return ERR_OK;
 }
@@ -346,6 +628,13 @@ static int8_t _tcp_accept(void * arg, AsyncClient * client) {
 
 #include "lwip/priv/tcpip_priv.h"
 
+static err_t _tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data *call){
+    uint32_t started = micros();
+    err_t err = tcpip_api_call(fn, call);
+    _stats_time(&_stats_api_call_time, micros() - started);
+    return err;
+}
+
 typedef struct {
     struct tcpip_api_call_data call;
     tcp_pcb * pcb;
@@ -356,7 +645,16 @@ typedef struct {
                     const char* data;
                     size_t size;
                     uint8_t apiflags;
+                    bool output;
             } write;
+            struct {
+                    const async_iovec_t* iov;
+                    size_t count;
+                    uint8_t apiflags;
+                    bool output;
+                    size_t queued;
+                    size_t written;
+            } writev;
             size_t received;
             struct {
                     ip_addr_t * addr;
@@ -387,7 +685,7 @@ static esp_err_t _tcp_output(tcp_pcb * pcb, int8_t closed_slot) {
     tcp_api_call_t msg;
     msg.pcb = pcb;
     msg.closed_slot = closed_slot;
-    tcpip_api_call(_tcp_output_api, (struct tcpip_api_call_data*)&msg);
+    _tcpip_api_call(_tcp_output_api, (struct tcpip_api_call_data*)&msg);
     return msg.err;
 }
 
@@ -396,11 +694,16 @@ static err_t _tcp_write_api(struct tcpip_api_call_data *api_call_msg){
     msg->err = ERR_CONN;
     if(msg->closed_slot == -1 || !_closed_slots[msg->closed_slot]) {
         msg->err = tcp_write(msg->pcb, msg->write.data, msg->write.size, msg->write.apiflags);
+        if(msg->err == ERR_OK && msg->write.output) {
+            //the data is queued either way, lwIP retries a failed output from its timers
+            tcp_output(msg->pcb);
+        }
     }
     return msg->err;
 }
 
-static esp_err_t _tcp_write(tcp_pcb * pcb, int8_t closed_slot, const char* data, size_t size, uint8_t apiflags) {
+//output flushes the data in the same call, saving the round trip of a separate _tcp_output
+static esp_err_t _tcp_write(tcp_pcb * pcb, int8_t closed_slot, const char* data, size_t size, uint8_t apiflags, bool output = false) {
     if(!pcb){
         return ERR_CONN;
     }
@@ -410,7 +713,62 @@ static esp_err_t _tcp_write(tcp_pcb * pcb, int8_t closed_slot, const char* data,
     msg.write.data = data;
     msg.write.size = size;
     msg.write.apiflags = apiflags;
-    tcpip_api_call(_tcp_write_api, (struct tcpip_api_call_data*)&msg);
+    msg.write.output = output;
+    _tcpip_api_call(_tcp_write_api, (struct tcpip_api_call_data*)&msg);
+    return msg.err;
+}
+
+static err_t _tcp_writev_api(struct tcpip_api_call_data *api_call_msg){
+    tcp_api_call_t * msg = (tcp_api_call_t *)api_call_msg;
+    msg->err = ERR_CONN;
+    msg->writev.queued = 0;
+    msg->writev.written = 0;
+    if(msg->closed_slot == -1 || !_closed_slots[msg->closed_slot]) {
+        msg->err = ERR_OK;
+        size_t room = tcp_sndbuf(msg->pcb);
+        for (size_t i = 0; i < msg->writev.count && room; ++ i) {
+            const async_iovec_t * v = &msg->writev.iov[i];
+            size_t len = (room < v->len) ? room : v->len;
+            uint8_t apiflags = msg->writev.apiflags;
+            if(len < v->len || (i + 1) < msg->writev.count) {
+                apiflags |= TCP_WRITE_FLAG_MORE;
+            }
+            if(len) {
+                msg->err = tcp_write(msg->pcb, v->data, len, apiflags);
+                if(msg->err != ERR_OK) {
+                    break;
+                }
+            }
+            msg->writev.written += len;
+            room -= len;
+            if(len < v->len) {
+                break;
+            }
+            msg->writev.queued++;
+        }
+        if(msg->writev.written && msg->writev.output) {
+            tcp_output(msg->pcb);
+        }
+    }
+    return msg->err;
+}
+
+static esp_err_t _tcp_writev(tcp_pcb * pcb, int8_t closed_slot, const async_iovec_t* iov, size_t count, uint8_t apiflags, bool output, size_t * queued, size_t * written) {
+    *queued = 0;
+    *written = 0;
+    if(!pcb){
+        return ERR_CONN;
+    }
+    tcp_api_call_t msg;
+    msg.pcb = pcb;
+    msg.closed_slot = closed_slot;
+    msg.writev.iov = iov;
+    msg.writev.count = count;
+    msg.writev.apiflags = apiflags;
+    msg.writev.output = output;
+    _tcpip_api_call(_tcp_writev_api, (struct tcpip_api_call_data*)&msg);
+    *queued = msg.writev.queued;
+    *written = msg.writev.written;
     return msg.err;
 }
 
@@ -432,7 +790,7 @@ static esp_err_t _tcp_recved(tcp_pcb * pcb, int8_t closed_slot, size_t len) {
     msg.pcb = pcb;
     msg.closed_slot = closed_slot;
     msg.received = len;
-    tcpip_api_call(_tcp_recved_api, (struct tcpip_api_call_data*)&msg);
+    _tcpip_api_call(_tcp_recved_api, (struct tcpip_api_call_data*)&msg);
     return msg.err;
 }
 
@@ -452,7 +810,7 @@ static esp_err_t _tcp_close(tcp_pcb * pcb, int8_t closed_slot) {
     tcp_api_call_t msg;
     msg.pcb = pcb;
     msg.closed_slot = closed_slot;
-    tcpip_api_call(_tcp_close_api, (struct tcpip_api_call_data*)&msg);
+    _tcpip_api_call(_tcp_close_api, (struct tcpip_api_call_data*)&msg);
     return msg.err;
 }
 
@@ -472,7 +830,7 @@ static esp_err_t _tcp_abort(tcp_pcb * pcb, int8_t closed_slot) {
     tcp_api_call_t msg;
     msg.pcb = pcb;
     msg.closed_slot = closed_slot;
-    tcpip_api_call(_tcp_abort_api, (struct tcpip_api_call_data*)&msg);
+    _tcpip_api_call(_tcp_abort_api, (struct tcpip_api_call_data*)&msg);
     return msg.err;
 }
 
@@ -492,7 +850,7 @@ static esp_err_t _tcp_connect(tcp_pcb * pcb, int8_t closed_slot, ip_addr_t * add
     msg.connect.addr = addr;
     msg.connect.port = port;
     msg.connect.cb = cb;
-    tcpip_api_call(_tcp_connect_api, (struct tcpip_api_call_data*)&msg);
+    _tcpip_api_call(_tcp_connect_api, (struct tcpip_api_call_data*)&msg);
     return msg.err;
 }
 
@@ -511,7 +869,7 @@ static esp_err_t _tcp_bind(tcp_pcb * pcb, ip_addr_t * addr, uint16_t port) {
     msg.closed_slot = -1;
     msg.bind.addr = addr;
     msg.bind.port = port;
-    tcpip_api_call(_tcp_bind_api, (struct tcpip_api_call_data*)&msg);
+    _tcpip_api_call(_tcp_bind_api, (struct tcpip_api_call_data*)&msg);
     return msg.err;
 }
 
@@ -530,7 +888,7 @@ static tcp_pcb * _tcp_listen_with_backlog(tcp_pcb * pcb, uint8_t backlog) {
     msg.pcb = pcb;
     msg.closed_slot = -1;
     msg.backlog = backlog?backlog:0xFF;
-    tcpip_api_call(_tcp_listen_api, (struct tcpip_api_call_data*)&msg);
+    _tcpip_api_call(_tcp_listen_api, (struct tcpip_api_call_data*)&msg);
     return msg.pcb;
 }
 
@@ -540,6 +898,41 @@ static tcp_pcb * _tcp_listen_with_backlog(tcp_pcb * pcb, uint8_t backlog) {
   Async TCP Client
  */
 
+// Storage for accepted and user created clients, so a new connection does
+// not have to go to the heap. Uses the same bitmap scheme as the event pool.
+typedef struct {
+    alignas(AsyncClient) uint8_t data[sizeof(AsyncClient)];
+} async_client_slot_t;
+
+const int _number_of_client_slots = CONFIG_LWIP_MAX_ACTIVE_TCP;
+static async_client_slot_t _client_slots[_number_of_client_slots];
+static std::atomic<uint32_t> _client_slots_used[(_number_of_client_slots + 31) / 32];
+static std::atomic<uint32_t> _client_pool_misses(0);
+
+void* AsyncClient::operator new(size_t size) noexcept {
+    if (size == sizeof(AsyncClient)) {
+        int slot = _take_pool_slot(_client_slots_used, _number_of_client_slots);
+        if (slot >= 0) {
+            return _client_slots[slot].data;
+        }
+    }
+    _client_pool_misses.fetch_add(1, std::memory_order_relaxed);
+    return malloc(size);
+}
+
+void AsyncClient::operator delete(void* ptr){
+    async_client_slot_t * s = (async_client_slot_t *)ptr;
+    if (s >= _client_slots && s < _client_slots + _number_of_client_slots) {
+        _give_pool_slot(_client_slots_used, s - _client_slots);
+    } else {
+        ::free(ptr);
+    }
+}
+
+uint32_t async_tcp_client_pool_misses(){
+    return _client_pool_misses.load(std::memory_order_relaxed);
+}
+
 AsyncClient::AsyncClient(tcp_pcb* pcb)
 : _connect_cb(0)
 , _connect_cb_arg(0)
@@ -555,18 +948,36 @@ AsyncClient::AsyncClient(tcp_pcb* pcb)
 , _pb_cb_arg(0)
 , _timeout_cb(0)
 , _timeout_cb_arg(0)
+, _poll_cb(0)
+, _poll_cb_arg(0)
 , _pcb_busy(false)
 , _pcb_sent_at(0)
 , _ack_pcb(true)
+, _rx_ack_len(0)
 , _rx_last_packet(0)
 , _rx_since_timeout(0)
 , _ack_timeout(ASYNC_MAX_ACK_TIME)
 , _connect_port(0)
+, _event_slot(-1)
+, _high_priority(false)
+, _tx_pending_head(0)
+, _tx_pending_count(0)
+, _tx_queued(0)
+, _tx_acked(0)
+, _rx_bytes(0)
+, _corked(false)
+, _tx_unflushed(false)
+, _timer_next(NULL)
+, _timer_prev(NULL)
+, _timer_due(0)
+, _timer_wheel(-1)
 , prev(NULL)
 , next(NULL)
 {
     _pcb = pcb;
     _closed_slot = -1;
+    _server = NULL;
+    _allocate_event_slot();
     if(_pcb){
         _allocate_closed_slot();
         _rx_last_packet = millis();
@@ -582,7 +993,13 @@ AsyncClient::~AsyncClient(){
     if(_pcb) {
         _close();
     }
+    _timer_cancel();
+    _release_buffers(true);
     _free_closed_slot();
+    _free_event_slot();
+    if(_server) {
+        _server->_clients--;
+    }
 }
 
 /*
@@ -746,6 +1163,14 @@ size_t AsyncClient::space(){
 }
 
 size_t AsyncClient::add(const char* data, size_t size, uint8_t apiflags) {
+    return _add(data, size, apiflags, false);
+}
+
+size_t AsyncClient::addv(const async_iovec_t* iov, size_t count, uint8_t apiflags) {
+    return _addv(iov, count, apiflags, false);
+}
+
+size_t AsyncClient::_add(const char* data, size_t size, uint8_t apiflags, bool flush) {
     if(!_pcb || size == 0 || data == NULL) {
         return 0;
     }
@@ -755,19 +1180,86 @@ size_t AsyncClient::add(const char* data, size_t size, uint8_t apiflags) {
     }
     size_t will_send = (room < size) ? room : size;
     int8_t err = ERR_OK;
-    err = _tcp_write(_pcb, _closed_slot, data, will_send, apiflags);
+    err = _tcp_write(_pcb, _closed_slot, data, will_send, apiflags, flush);
     if(err != ERR_OK) {
         return 0;
     }
+    _tx_queued += will_send;
+    _tx_flushed(flush);
     return will_send;
 }
 
+size_t AsyncClient::_addv(const async_iovec_t* iov, size_t count, uint8_t apiflags, bool flush) {
+    if(!_pcb || iov == NULL || count == 0) {
+        return 0;
+    }
+    //every buffer holds a pending slot until it is acked
+    size_t free_slots = ASYNC_MAX_PENDING_BUFFERS - _tx_pending_count;
+    if(count > free_slots) {
+        count = free_slots;
+    }
+    if(!count || !space()) {
+        return 0;
+    }
+    size_t queued = 0;
+    size_t written = 0;
+    _tcp_writev(_pcb, _closed_slot, iov, count, apiflags, flush, &queued, &written);
+    uint32_t start = _tx_queued;
+    for (size_t i = 0; i < queued; ++ i) {
+        _tx_queued += iov[i].len;
+        uint8_t tail = (_tx_pending_head + _tx_pending_count) % ASYNC_MAX_PENDING_BUFFERS;
+        _tx_pending[tail].iov = iov[i];
+        _tx_pending[tail].end = _tx_queued;
+        _tx_pending_count++;
+    }
+    //the rest belongs to a partly queued buffer. lwIP references it already, so it holds
+    //a slot without a release handler: close() then aborts instead of sending it after the
+    //owner is gone. The owner releases the buffer once the remainder, added again, is acked
+    uint32_t partial = start + written - _tx_queued;
+    _tx_queued = start + written;
+    if(partial) {
+        uint8_t tail = (_tx_pending_head + _tx_pending_count) % ASYNC_MAX_PENDING_BUFFERS;
+        _tx_pending[tail].iov.data = iov[queued].data;
+        _tx_pending[tail].iov.len = partial;
+        _tx_pending[tail].iov.release = NULL;
+        _tx_pending[tail].iov.arg = NULL;
+        _tx_pending[tail].end = _tx_queued;
+        _tx_pending_count++;
+    }
+    if(written) {
+        _tx_flushed(flush);
+    }
+    return written;
+}
+
+void AsyncClient::_tx_flushed(bool flushed){
+    if(flushed) {
+        _tx_unflushed = false;
+        _pcb_busy = true;
+        _pcb_sent_at = millis();
+        _timer_schedule();
+    } else {
+        _tx_unflushed = true;
+    }
+}
+
+void AsyncClient::cork(){
+    _corked = true;
+}
+
+bool AsyncClient::uncork(){
+    _corked = false;
+    if(!_tx_unflushed) {
+        return true;
+    }
+    return send();
+}
+
 bool AsyncClient::send(){
     int8_t err = ERR_OK;
     err = _tcp_output(_pcb, _closed_slot);
     if(err == ERR_OK){
-        _pcb_busy = true;
-        _pcb_sent_at = millis();
+        _tx_flushed(true);
         return true;
     }
     return false;
@@ -787,7 +1279,7 @@ void AsyncClient::ackPacket(struct pbuf * pb){
   if(!pb){
     return;
   }
-  _tcp_recved(_pcb, _closed_slot, pb->len);
+  _tcp_recved(_pcb, _closed_slot, pb->tot_len);
   pbuf_free(pb);
 }
 
@@ -805,12 +1297,19 @@ int8_t AsyncClient::_close(){
         tcp_recv(_pcb, NULL);
         tcp_err(_pcb, NULL);
         tcp_poll(_pcb, NULL, 0);
-        _tcp_clear_events(this);
-        err = _tcp_close(_pcb, _closed_slot);
-        if(err != ERR_OK) {
+        _clear_events();
+        _timer_cancel();
+        if(_tx_pending_count) {
+            //lwIP must drop its references before the addv buffers are released
             err = abort();
+        } else {
+            err = _tcp_close(_pcb, _closed_slot);
+            if(err != ERR_OK) {
+                err = abort();
+            }
         }
         _pcb = NULL;
+        _release_buffers(true);
         if(_discard_cb) {
             _discard_cb(_discard_cb_arg, this);
         }
@@ -833,6 +1332,117 @@ void AsyncClient::_allocate_closed_slot(){
     xSemaphoreGive(_slots_lock);
 }
 
+// A client is in a wheel only while an ack is outstanding or an rx timeout
+// is set; anything else has nothing that can expire.
+void AsyncClient::_timer_schedule(){
+    uint32_t now = millis();
+    uint32_t delay = 0;
+    bool due = false;
+    if(_pcb_busy && _ack_timeout){
+        uint32_t elapsed = now - _pcb_sent_at;
+        delay = (elapsed >= _ack_timeout) ? 0 : (_ack_timeout - elapsed);
+        due = true;
+    }
+    if(_rx_since_timeout){
+        uint32_t limit = _rx_since_timeout * 1000;
+        uint32_t elapsed = now - _rx_last_packet;
+        uint32_t rx_delay = (elapsed >= limit) ? 0 : (limit - elapsed);
+        if(!due || rx_delay < delay){
+            delay = rx_delay;
+        }
+        due = true;
+    }
+    portENTER_CRITICAL(&_timer_mux);
+    _timer_unlink();
+    if(due && _pcb){
+        async_timer_wheel_t * w = &_timer_wheels[_high_priority ? (_number_of_queues - 1) : 0];
+        _timer_wheel = w - _timer_wheels;
+        _timer_due = w->tick + (delay + ASYNC_TIMER_TICK_MS - 1) / ASYNC_TIMER_TICK_MS + 1;
+        AsyncClient ** head = &w->buckets[_timer_due % ASYNC_TIMER_BUCKETS];
+        _timer_prev = NULL;
+        _timer_next = *head;
+        if(*head){
+            (*head)->_timer_prev = this;
+        }
+        *head = this;
+    }
+    portEXIT_CRITICAL(&_timer_mux);
+}
+
+void AsyncClient::_timer_cancel(){
+    portENTER_CRITICAL(&_timer_mux);
+    _timer_unlink();
+    portEXIT_CRITICAL(&_timer_mux);
+}
+
+//call with _timer_mux held
+void AsyncClient::_timer_unlink(){
+    if(_timer_wheel < 0){
+        return;
+    }
+    if(_timer_prev){
+        _timer_prev->_timer_next = _timer_next;
+    } else {
+        _timer_wheels[_timer_wheel].buckets[_timer_due % ASYNC_TIMER_BUCKETS] = _timer_next;
+    }
+    if(_timer_next){
+        _timer_next->_timer_prev = _timer_prev;
+    }
+    _timer_next = NULL;
+    _timer_prev = NULL;
+    _timer_wheel = -1;
+}
+
+//runs on the async task of the wheel
+void AsyncClient::_s_timeouts(int wheel){
+    async_timer_wheel_t * w = &_timer_wheels[wheel];
+    uint32_t ticks = (millis() - w->last) / ASYNC_TIMER_TICK_MS;
+    if(!ticks){
+        return;
+    }
+    w->last += ticks * ASYNC_TIMER_TICK_MS;
+    //one pass over the buckets finds everything that is overdue
+    if(ticks > ASYNC_TIMER_BUCKETS){
+        w->tick += ticks - ASYNC_TIMER_BUCKETS;
+        ticks = ASYNC_TIMER_BUCKETS;
+    }
+    while(ticks--){
+        w->tick++;
+        for(;;){
+            //take one client at a time, a timeout callback may delete the others
+            AsyncClient * c;
+            portENTER_CRITICAL(&_timer_mux);
+            c = w->buckets[w->tick % ASYNC_TIMER_BUCKETS];
+            while(c && (int32_t)(c->_timer_due - w->tick) > 0){
+                c = c->_timer_next;
+            }
+            if(c){
+                c->_timer_unlink();
+            }
+            portEXIT_CRITICAL(&_timer_mux);
+            if(!c){
+                break;
+            }
+            c->_timeouts();
+        }
+    }
+}
+
+void AsyncClient::_release_buffers(bool all){
+    while(_tx_pending_count) {
+        uint8_t head = _tx_pending_head;
+        if(!all && (int32_t)(_tx_acked - _tx_pending[head].end) < 0) {
+            break;
+        }
+        async_iovec_t iov = _tx_pending[head].iov;
+        _tx_pending_head = (head + 1) % ASYNC_MAX_PENDING_BUFFERS;
+        _tx_pending_count--;
+        if(iov.release) {
+            iov.release(iov.arg, iov.data, iov.len);
+        }
+    }
+}
+
 void AsyncClient::_free_closed_slot(){
     if (_closed_slot != -1) {
         _closed_slots[_closed_slot] = _closed_index;
@@ -841,6 +1451,33 @@ void AsyncClient::_free_closed_slot(){
     }
 }
 
+void AsyncClient::_allocate_event_slot(){
+    uint32_t generation = _next_event_generation();
+    for (int i = 0; i < _number_of_event_owners; ++ i) {
+        uint32_t free_slot = 0;
+        if (_event_generations[i].compare_exchange_strong(free_slot, generation, std::memory_order_acq_rel)) {
+            _event_slot = i;
+            return;
+        }
+    }
+    log_w("no free event slot, falling back to queue walks on close");
+}
+
+void AsyncClient::_free_event_slot(){
+    if (_event_slot != -1) {
+        _event_generations[_event_slot].store(0, std::memory_order_release);
+        _event_slot = -1;
+    }
+}
+
+void AsyncClient::_clear_events(){
+    if (_event_slot == -1) {
+        _tcp_clear_events(this);
+        return;
+    }
+    _event_generations[_event_slot].store(_next_event_generation(), std::memory_order_release);
+}
+
 /*
  * Private Callbacks
  * */
@@ -871,6 +1508,8 @@ void AsyncClient::_error(int8_t err) {
         }
         _pcb = NULL;
     }
+    _timer_cancel();
+    _release_buffers(true);
     if(_error_cb) {
         _error_cb(_error_cb_arg, this, err);
     }
@@ -882,7 +1521,7 @@ void AsyncClient::_error(int8_t err) {
 //In LwIP Thread
 int8_t AsyncClient::_lwip_fin(tcp_pcb* pcb, int8_t err) {
     if(!_pcb || pcb != _pcb){
-        log_e("0x%08x != 0x%08x", (uint32_t)pcb, (uint32_t)_pcb);
+        log_e("%p != %p", pcb, _pcb);
         return ERR_OK;
     }
     tcp_arg(_pcb, NULL);
@@ -892,7 +1531,11 @@ int8_t AsyncClient::_lwip_fin(tcp_pcb* pcb, int8_t err) {
         tcp_err(_pcb, NULL);
         tcp_poll(_pcb, NULL, 0);
     }
-    if(tcp_close(_pcb) != ERR_OK) {
+    if(_tx_pending_count) {
+        //addv buffers get released in _fin, lwIP must not send them after that
+        tcp_err(_pcb, NULL);
+        tcp_abort(_pcb);
+    } else if(tcp_close(_pcb) != ERR_OK) {
         tcp_abort(_pcb);
     }
     _free_closed_slot();
@@ -902,7 +1545,9 @@ int8_t AsyncClient::_lwip_fin(tcp_pcb* pcb, int8_t err) {
 
 //In Async Thread
 int8_t AsyncClient::_fin(tcp_pcb* pcb, int8_t err) {
-    _tcp_clear_events(this);
+    _clear_events();
+    _timer_cancel();
+    _release_buffers(true);
     if(_discard_cb) {
         _discard_cb(_discard_cb_arg, this);
     }
@@ -913,6 +1558,8 @@ int8_t AsyncClient::_sent(tcp_pcb* pcb, uint16_t len) {
     _rx_last_packet = millis();
     //log_i("%u", len);
     _pcb_busy = false;
+    _tx_acked += len;
+    _release_buffers(false);
     if(_sent_cb) {
         _sent_cb(_sent_cb_arg, this, len, (millis() - _pcb_sent_at));
     }
@@ -920,6 +1567,15 @@ int8_t AsyncClient::_sent(tcp_pcb* pcb, uint16_t len) {
 }
 
 int8_t AsyncClient::_recv(tcp_pcb* pcb, pbuf* pb, int8_t err) {
+    if(pb != NULL){
+        _rx_bytes += pb->tot_len;
+    }
+    if(pb != NULL && _pb_cb){
+        //hand over the whole chain, the receiver walks it and acks it with ackPacket()
+        _rx_last_packet = millis();
+        _pb_cb(_pb_cb_arg, this, pb);
+        return ERR_OK;
+    }
     while(pb != NULL) {
         _rx_last_packet = millis();
         //we should not ack before we assimilate the data
@@ -927,19 +1583,15 @@ int8_t AsyncClient::_recv(tcp_pcb* pcb, pbuf* pb, int8_t err) {
         pbuf *b = pb;
         pb = b->next;
         b->next = NULL;
-        if(_pb_cb){
-            _pb_cb(_pb_cb_arg, this, b);
-        } else {
-            if(_recv_cb) {
-                _recv_cb(_recv_cb_arg, this, b->payload, b->len);
-            }
-            if(!_ack_pcb) {
-                _rx_ack_len += b->len;
-            } else if(_pcb) {
-                _tcp_recved(_pcb, _closed_slot, b->len);
-            }
-            pbuf_free(b);
+        if(_recv_cb) {
+            _recv_cb(_recv_cb_arg, this, b->payload, b->len);
+        }
+        if(!_ack_pcb) {
+            _rx_ack_len += b->len;
+        } else if(_pcb) {
+            _tcp_recved(_pcb, _closed_slot, b->len);
         }
+        pbuf_free(b);
     }
     return ERR_OK;
 }
@@ -950,31 +1602,41 @@ int8_t AsyncClient::_poll(tcp_pcb* pcb){
         return ERR_OK;
     }
     if(pcb != _pcb){
-        log_e("0x%08x != 0x%08x", (uint32_t)pcb, (uint32_t)_pcb);
+        log_e("%p != %p", pcb, _pcb);
         return ERR_OK;
     }
 
+    if(_poll_cb) {
+        _poll_cb(_poll_cb_arg, this);
+    }
+    return ERR_OK;
+}
+
+void AsyncClient::_timeouts(){
+    if(!_pcb){
+        return;
+    }
+
     uint32_t now = millis();
 
     // ACK Timeout
     if(_pcb_busy && _ack_timeout && (now - _pcb_sent_at) >= _ack_timeout){
         _pcb_busy = false;
-        log_w("ack timeout %d", pcb->state);
+        log_w("ack timeout %d", _pcb->state);
+        //rearm for the rx timeout first, the callback may well delete us
+        _timer_schedule();
         if(_timeout_cb)
             _timeout_cb(_timeout_cb_arg, this, (now - _pcb_sent_at));
-        return ERR_OK;
+        return;
     }
     // RX Timeout
     if(_rx_since_timeout && (now - _rx_last_packet) >= (_rx_since_timeout * 1000)){
-        log_w("rx timeout %d", pcb->state);
+        log_w("rx timeout %d", _pcb->state);
         _close();
-        return ERR_OK;
-    }
-    // Everything is fine
-    if(_poll_cb) {
-        _poll_cb(_poll_cb_arg, this);
+        return;
     }
-    return ERR_OK;
+    // Not due yet, traffic moved the deadline
+    _timer_schedule();
 }
 
 void AsyncClient::_dns_found(struct ip_addr *ipaddr){
@@ -1016,15 +1678,16 @@ size_t AsyncClient::write(const char* data) {
 }
 
 size_t AsyncClient::write(const char* data, size_t size, uint8_t apiflags) {
-    size_t will_send = add(data, size, apiflags);
-    if(!will_send || !send()) {
-        return 0;
-    }
-    return will_send;
+    return _add(data, size, apiflags, !_corked);
+}
+
+size_t AsyncClient::writev(const async_iovec_t* iov, size_t count, uint8_t apiflags) {
+    return _addv(iov, count, apiflags, !_corked);
 }
 
 void AsyncClient::setRxTimeout(uint32_t timeout){
     _rx_since_timeout = timeout;
+    _timer_schedule();
 }
 
 uint32_t AsyncClient::getRxTimeout(){
@@ -1037,6 +1700,7 @@ uint32_t AsyncClient::getAckTimeout(){
 
 void AsyncClient::setAckTimeout(uint32_t timeout){
     _ack_timeout = timeout;
+    _timer_schedule();
 }
 
 void AsyncClient::setNoDelay(bool nodelay){
@@ -1057,6 +1721,29 @@ bool AsyncClient::getNoDelay(){
     return tcp_nagle_disabled(_pcb);
 }
 
+void AsyncClient::setHighPriority(bool high){
+    _high_priority = high;
+    if(_timer_wheel >= 0){
+        _timer_schedule();
+    }
+}
+
+uint32_t AsyncClient::getTxBytes(){
+    return _tx_queued;
+}
+
+uint32_t AsyncClient::getAckedBytes(){
+    return _tx_acked;
+}
+
+uint32_t AsyncClient::getRxBytes(){
+    return _rx_bytes;
+}
+
+bool AsyncClient::getHighPriority(){
+    return _high_priority;
+}
+
 uint16_t AsyncClient::getMss(){
     if(!_pcb) {
         return 0;
@@ -1238,6 +1925,16 @@ AsyncServer::AsyncServer(IPAddress addr, uint16_t port)
 : _port(port)
 , _addr(addr)
 , _noDelay(false)
+, _highPriority(false)
+, _backlog(5)
+, _maxClients(0)
+, _acceptRate(0)
+, _acceptBurst(1)
+, _acceptTokens(0)
+, _acceptRefilledAt(0)
+, _refusal(NULL)
+, _clients(0)
+, _refused(0)
 , _pcb(0)
 , _connect_cb(0)
 , _connect_cb_arg(0)
@@ -1247,6 +1944,16 @@ AsyncServer::AsyncServer(uint16_t port)
 : _port(port)
 , _addr((uint32_t) IPADDR_ANY)
 , _noDelay(false)
+, _highPriority(false)
+, _backlog(5)
+, _maxClients(0)
+, _acceptRate(0)
+, _acceptBurst(1)
+, _acceptTokens(0)
+, _acceptRefilledAt(0)
+, _refusal(NULL)
+, _clients(0)
+, _refused(0)
 , _pcb(0)
 , _connect_cb(0)
 , _connect_cb_arg(0)
@@ -1288,8 +1995,7 @@ void AsyncServer::begin(){
         return;
     }
 
-    static uint8_t backlog = 5;
-    _pcb = _tcp_listen_with_backlog(_pcb, backlog);
+    _pcb = _tcp_listen_with_backlog(_pcb, _backlog);
     if (!_pcb) {
         log_e("listen_pcb == NULL");
         return;
@@ -1312,10 +2018,20 @@ void AsyncServer::end(){
 //runs on LwIP thread
 int8_t AsyncServer::_accept(tcp_pcb* pcb, int8_t err){
     //ets_printf("+A: 0x%08x\n", pcb);
+    if(_connect_cb && !_acceptAllowed()){
+        return _refuse(pcb);
+    }
     if(_connect_cb){
         AsyncClient *c = new AsyncClient(pcb);
         if(c){
+            if(_acceptRate){
+                //only a connection that got a client pays for it
+                _acceptTokens -= 1000;
+            }
             c->setNoDelay(_noDelay);
+            c->setHighPriority(_highPriority);
+            c->_server = this;
+            _clients++;
             return _tcp_accept(this, c);
         }
     }
@@ -1326,6 +2042,46 @@ int8_t AsyncServer::_accept(tcp_pcb* pcb, int8_t err){
     return ERR_OK;
 }
 
+//runs on LwIP thread
+bool AsyncServer::_acceptAllowed(){
+    if(_maxClients && _clients >= _maxClients){
+        return false;
+    }
+    if(_acceptRate){
+        //one connection costs 1000 tokens, _acceptRate of them are earned every millisecond
+        uint32_t now = millis();
+        uint32_t cap = (uint32_t)_acceptBurst * 1000;
+        uint64_t tokens = _acceptTokens + (uint64_t)(now - _acceptRefilledAt) * _acceptRate;
+        _acceptRefilledAt = now;
+        _acceptTokens = (tokens > cap) ? cap : (uint32_t)tokens;
+        if(_acceptTokens < 1000){
+            return false;
+        }
+    }
+    return true;
+}
+
+//runs on LwIP thread
+int8_t AsyncServer::_refuse(tcp_pcb* pcb){
+    _refused++;
+    //tcp_close() would reset the connection as soon as the request arrives. Only the sending
+    //side is shut, lwIP's default receive callback drains the request and closes on the
+    //client's FIN. Clients that never send one are reset by the poll timer
+    tcp_arg(pcb, NULL);
+    if(_refusal && tcp_write(pcb, _refusal, strlen(_refusal), 0) == ERR_OK && tcp_shutdown(pcb, 0, 1) == ERR_OK){
+        tcp_poll(pcb, &_s_refused_poll, ASYNC_REFUSAL_TIMEOUT * 2);
+        return ERR_OK;
+    }
+    tcp_abort(pcb);
+    return ERR_ABRT;
+}
+
+//runs on LwIP thread
+int8_t AsyncServer::_s_refused_poll(void * arg, tcp_pcb * pcb){
+    tcp_abort(pcb);
+    return ERR_ABRT;
+}
+
 int8_t AsyncServer::_accepted(AsyncClient* client){
     if(_connect_cb){
         _connect_cb(_connect_cb_arg, client);
@@ -1341,6 +2097,49 @@ bool AsyncServer::getNoDelay(){
     return _noDelay;
 }
 
+void AsyncServer::setHighPriority(bool high){
+    _highPriority = high;
+}
+
+bool AsyncServer::getHighPriority(){
+    return _highPriority;
+}
+
+void AsyncServer::setBacklog(uint8_t backlog){
+    _backlog = backlog;
+}
+
+uint8_t AsyncServer::getBacklog(){
+    return _backlog;
+}
+
+void AsyncServer::setMaxClients(uint16_t max){
+    _maxClients = max;
+}
+
+uint16_t AsyncServer::getMaxClients(){
+    return _maxClients;
+}
+
+void AsyncServer::setAcceptRate(uint16_t per_second, uint16_t burst){
+    _acceptRate = per_second;
+    _acceptBurst = burst ? burst : 1;
+    _acceptTokens = (uint32_t)_acceptBurst * 1000;
+    _acceptRefilledAt = millis();
+}
+
+void AsyncServer::setRefusal(const char* data){
+    _refusal = data;
+}
+
+uint16_t AsyncServer::clients(){
+    return _clients;
+}
+
+uint32_t AsyncServer::refused(){
+    return _refused;
+}
+
 uint8_t AsyncServer::status(){
     if (!_pcb) {
         return 0;
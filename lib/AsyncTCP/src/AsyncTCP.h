@@ -25,6 +25,7 @@
 #include "IPAddress.h"
 #include "sdkconfig.h"
 #include <functional>
+#include <atomic>
 extern "C" {
     #include "freertos/semphr.h"
     #include "lwip/pbuf.h"
@@ -33,30 +34,92 @@ extern "C" {
 //If core is not defined, then we are running in Arduino or PIO
 #ifndef CONFIG_ASYNC_TCP_RUNNING_CORE
 #define CONFIG_ASYNC_TCP_RUNNING_CORE -1 //any available core
-#define CONFIG_ASYNC_TCP_USE_WDT 1 //if enabled, adds between 33us and 200us per event
+#define CONFIG_ASYNC_TCP_USE_WDT 1 //if enabled, adds between 33us and 200us per batch of events
+#endif
+
+#ifndef CONFIG_ASYNC_TCP_EVENT_BATCH
+#define CONFIG_ASYNC_TCP_EVENT_BATCH 8 //max events handled per wakeup of the async task
+#endif
+
+#ifndef CONFIG_ASYNC_TCP_QUEUE_LENGTH
+#define CONFIG_ASYNC_TCP_QUEUE_LENGTH 32 //depth of each event queue
+#endif
+
+#ifndef CONFIG_ASYNC_TCP_PRIORITY_QUEUE
+#define CONFIG_ASYNC_TCP_PRIORITY_QUEUE 0 //if enabled, high priority clients get their own queue and task
 #endif
 
 class AsyncClient;
+class AsyncServer;
+
+//number of lwIP events that fell back to malloc because the event packet pool was exhausted
+uint32_t async_tcp_event_pool_misses();
+//number of clients that fell back to malloc because the client pool was exhausted
+uint32_t async_tcp_client_pool_misses();
+
+#define ASYNC_TCP_EVENT_TYPES 9 //sent, recv, fin, error, poll, clear, accept, connected, dns
+#define ASYNC_TCP_STATS_BUCKETS 8 //<=16us, <=64us, <=256us, <=1024us, <=4096us, <=16384us, <=65536us, the rest
+
+typedef struct {
+    uint32_t count;
+    uint32_t min; //microseconds, 0 until something was recorded
+    uint32_t max;
+    uint64_t sum;
+    uint32_t buckets[ASYNC_TCP_STATS_BUCKETS];
+} async_tcp_timing_t;
+
+typedef struct {
+    uint32_t events[ASYNC_TCP_EVENT_TYPES]; //events handled by the async task, by type
+    uint32_t events_dropped; //queued events dropped because their client went away
+    async_tcp_timing_t event_time; //time spent handling one event
+    async_tcp_timing_t api_call_time; //round trip of a call into the TCP/IP thread
+    uint32_t queue_depth; //events waiting right now, all queues
+    uint32_t queue_depth_max; //deepest a queue got when the async task picked up an event
+    uint32_t closed_slots_used;
+    uint32_t event_pool_misses;
+    uint32_t client_pool_misses;
+} async_tcp_stats_t;
+
+void async_tcp_get_stats(async_tcp_stats_t * stats); //snapshot of the global counters
+void async_tcp_reset_stats();
+const char * async_tcp_event_name(int type); //name of an index into async_tcp_stats_t::events
 
 #define ASYNC_MAX_ACK_TIME 5000
+#define ASYNC_REFUSAL_TIMEOUT 2 //seconds a refused connection has to read the refusal and close before it is reset
 #define ASYNC_WRITE_FLAG_COPY 0x01 //will allocate new buffer to hold the data while sending (else will hold reference to the data given)
 #define ASYNC_WRITE_FLAG_MORE 0x02 //will not send PSH flag, meaning that there should be more data to be sent before the application should react.
+#define ASYNC_MAX_PENDING_BUFFERS 8 //buffers queued with addv() that can wait for their ack at the same time
 
-typedef std::function<void(void*, AsyncClient*)> AcConnectHandler;
-typedef std::function<void(void*, AsyncClient*, size_t len, uint32_t time)> AcAckHandler;
-typedef std::function<void(void*, AsyncClient*, int8_t error)> AcErrorHandler;
-typedef std::function<void(void*, AsyncClient*, void *data, size_t len)> AcDataHandler;
-typedef std::function<void(void*, AsyncClient*, struct pbuf *pb)> AcPacketHandler;
-typedef std::function<void(void*, AsyncClient*, uint32_t time)> AcTimeoutHandler;
+typedef void (*AcBufferReleaseHandler)(void* arg, const char* data, size_t len);
+
+typedef struct {
+    const char* data;
+    size_t len;
+    AcBufferReleaseHandler release; //called once the buffer is acked or the connection goes away, may be NULL
+    void* arg;
+} async_iovec_t;
+
+//plain function pointers, the context goes in the arg passed along with the callback
+typedef void (*AcConnectHandler)(void*, AsyncClient*);
+typedef void (*AcAckHandler)(void*, AsyncClient*, size_t len, uint32_t time);
+typedef void (*AcErrorHandler)(void*, AsyncClient*, int8_t error);
+typedef void (*AcDataHandler)(void*, AsyncClient*, void *data, size_t len);
+typedef void (*AcPacketHandler)(void*, AsyncClient*, struct pbuf *pb);
+typedef void (*AcTimeoutHandler)(void*, AsyncClient*, uint32_t time);
 
 struct tcp_pcb;
 struct ip_addr;
 
 class AsyncClient {
+  friend class AsyncServer;
   public:
     AsyncClient(tcp_pcb* pcb = 0);
     ~AsyncClient();
 
+    //clients come from a static pool of CONFIG_LWIP_MAX_ACTIVE_TCP, the heap is only used once it runs out
+    static void* operator new(size_t size) noexcept;
+    static void operator delete(void* ptr);
+
     AsyncClient & operator=(const AsyncClient &other);
     AsyncClient & operator+=(const AsyncClient &other);
 
@@ -76,10 +139,18 @@ class AsyncClient {
     size_t space();//space available in the TCP window
     size_t add(const char* data, size_t size, uint8_t apiflags=ASYNC_WRITE_FLAG_COPY);//add for sending
     bool send();//send all data added with the method above
+    //add several buffers with one call into the TCP/IP thread. The buffers are held by reference until acked,
+    //then released one by one. A buffer that only partly fits is not released, add its remainder again;
+    //until that is acked close() aborts the connection so lwIP lets go of the part it took.
+    size_t addv(const async_iovec_t* iov, size_t count, uint8_t apiflags=0);
 
-    //write equals add()+send()
+    //write equals add()+send() in a single call into the TCP/IP thread
     size_t write(const char* data);
     size_t write(const char* data, size_t size, uint8_t apiflags=ASYNC_WRITE_FLAG_COPY); //only when canSend() == true
+    size_t writev(const async_iovec_t* iov, size_t count, uint8_t apiflags=0); //addv()+send()
+
+    void cork();//write() and writev() only queue data until uncork()
+    bool uncork();//flush everything written while corked with one send()
 
     uint8_t state();
     bool connecting();
@@ -99,6 +170,13 @@ class AsyncClient {
     void setNoDelay(bool nodelay);
     bool getNoDelay();
 
+    void setHighPriority(bool high);//set before connecting; events go to the high priority queue if enabled
+    bool getHighPriority();
+
+    uint32_t getTxBytes();//bytes handed to lwIP for sending
+    uint32_t getAckedBytes();//bytes acked by the remote
+    uint32_t getRxBytes();//bytes received
+
     uint32_t getRemoteAddress();
     uint16_t getRemotePort();
     uint32_t getLocalAddress();
@@ -115,11 +193,11 @@ class AsyncClient {
     void onAck(AcAckHandler cb, void* arg = 0);             //ack received
     void onError(AcErrorHandler cb, void* arg = 0);         //unsuccessful connect or error
     void onData(AcDataHandler cb, void* arg = 0);           //data received (called if onPacket is not used)
-    void onPacket(AcPacketHandler cb, void* arg = 0);       //data received
+    void onPacket(AcPacketHandler cb, void* arg = 0);       //data received as a pbuf chain (walk pb->next, then ackPacket the head)
     void onTimeout(AcTimeoutHandler cb, void* arg = 0);     //ack timeout
-    void onPoll(AcConnectHandler cb, void* arg = 0);        //every 125ms when connected
+    void onPoll(AcConnectHandler cb, void* arg = 0);        //every 125ms when connected (no poll events are queued without it)
 
-    void ackPacket(struct pbuf * pb);//ack pbuf from onPacket
+    void ackPacket(struct pbuf * pb);//ack and free the whole pbuf chain from onPacket
     size_t ack(size_t len); //ack data that you have not acked using the method below
     void ackLater(){ _ack_pcb = false; } //will not ack the current packet. Call from onData
 
@@ -135,13 +213,17 @@ class AsyncClient {
     static int8_t _s_sent(void *arg, struct tcp_pcb *tpcb, uint16_t len);
     static int8_t _s_connected(void* arg, void* tpcb, int8_t err);
     static void _s_dns_found(const char *name, struct ip_addr *ipaddr, void *arg);
+    static void _s_timeouts(int wheel);
 
     int8_t _recv(tcp_pcb* pcb, pbuf* pb, int8_t err);
     tcp_pcb * pcb(){ return _pcb; }
+    int8_t eventSlot(){ return _event_slot; }
+    bool wantsPoll(){ return _poll_cb != NULL; }
 
   protected:
     tcp_pcb* _pcb;
     int8_t  _closed_slot;
+    AsyncServer* _server;
 
     AcConnectHandler _connect_cb;
     void* _connect_cb_arg;
@@ -168,10 +250,40 @@ class AsyncClient {
     uint32_t _rx_since_timeout;
     uint32_t _ack_timeout;
     uint16_t _connect_port;
+    int8_t _event_slot;
+    bool _high_priority;
+
+    struct {
+        async_iovec_t iov;
+        uint32_t end;
+    } _tx_pending[ASYNC_MAX_PENDING_BUFFERS];
+    uint8_t _tx_pending_head;
+    uint8_t _tx_pending_count;
+    uint32_t _tx_queued;
+    uint32_t _tx_acked;
+    uint32_t _rx_bytes;
+    bool _corked;
+    bool _tx_unflushed;
+
+    AsyncClient* _timer_next;
+    AsyncClient* _timer_prev;
+    uint32_t _timer_due;
+    int8_t _timer_wheel;
 
     int8_t _close();
     void _free_closed_slot();
     void _allocate_closed_slot();
+    void _free_event_slot();
+    void _allocate_event_slot();
+    void _clear_events();
+    void _release_buffers(bool all);
+    size_t _add(const char* data, size_t size, uint8_t apiflags, bool flush);
+    size_t _addv(const async_iovec_t* iov, size_t count, uint8_t apiflags, bool flush);
+    void _tx_flushed(bool flushed);
+    void _timer_schedule();
+    void _timer_cancel();
+    void _timer_unlink();
+    void _timeouts();
     int8_t _connected(void* pcb, int8_t err);
     void _error(int8_t err);
     int8_t _poll(tcp_pcb* pcb);
@@ -186,6 +298,7 @@ class AsyncClient {
 };
 
 class AsyncServer {
+  friend class AsyncClient;
   public:
     AsyncServer(IPAddress addr, uint16_t port);
     AsyncServer(uint16_t port);
@@ -195,22 +308,46 @@ class AsyncServer {
     void end();
     void setNoDelay(bool nodelay);
     bool getNoDelay();
+    void setHighPriority(bool high);//accepted clients inherit this
+    bool getHighPriority();
+    void setBacklog(uint8_t backlog);//pending connections lwIP holds before accept, set before begin()
+    uint8_t getBacklog();
+    void setMaxClients(uint16_t max);//connections above this are refused before a client is allocated, 0 for no limit
+    uint16_t getMaxClients();
+    void setAcceptRate(uint16_t per_second, uint16_t burst = 1);//token bucket for new connections, 0 for no limit
+    //static data written to refused connections before they are closed (e.g. an HTTP 503), NULL resets them instead
+    void setRefusal(const char* data);
+    uint16_t clients();//accepted clients that have not been destroyed yet
+    uint32_t refused();//connections refused so far
     uint8_t status();
 
     //Do not use any of the functions below!
     static int8_t _s_accept(void *arg, tcp_pcb* newpcb, int8_t err);
     static int8_t _s_accepted(void *arg, AsyncClient* client);
+    static int8_t _s_refused_poll(void *arg, tcp_pcb* pcb);
 
   protected:
     uint16_t _port;
     IPAddress _addr;
     bool _noDelay;
+    bool _highPriority;
+    uint8_t _backlog;
+    uint16_t _maxClients;
+    uint16_t _acceptRate;
+    uint16_t _acceptBurst;
+    uint32_t _acceptTokens;
+    uint32_t _acceptRefilledAt;
+    const char* _refusal;
+    std::atomic<uint16_t> _clients;
+    std::atomic<uint32_t> _refused;
     tcp_pcb* _pcb;
     AcConnectHandler _connect_cb;
     void* _connect_cb_arg;
 
     int8_t _accept(tcp_pcb* newpcb, int8_t err);
     int8_t _accepted(AsyncClient* client);
+    bool _acceptAllowed();
+    int8_t _refuse(tcp_pcb* pcb);
 };
 
 
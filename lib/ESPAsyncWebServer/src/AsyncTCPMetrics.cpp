@@ -0,0 +1,69 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "AsyncTCPMetrics.h"
+
+static const uint32_t _bucket_limits[ASYNC_TCP_STATS_BUCKETS - 1] = { 16, 64, 256, 1024, 4096, 16384, 65536 };
+
+//a histogram <name>_us plus the extremes as the gauges <name>_min_us and <name>_max_us,
+//a metric family may only carry the samples its type defines
+static void _printTiming(AsyncResponseStream *response, const char *name, const async_tcp_timing_t& t){
+  response->printf("# TYPE %s_us histogram\n", name);
+  uint32_t count = 0;
+  for(int i = 0; i < ASYNC_TCP_STATS_BUCKETS - 1; i++){
+    count += t.buckets[i];
+    response->printf("%s_us_bucket{le=\"%u\"} %u\n", name, _bucket_limits[i], count);
+  }
+  response->printf("%s_us_bucket{le=\"+Inf\"} %u\n", name, t.count);
+  response->printf("%s_us_sum %llu\n", name, (unsigned long long)t.sum);
+  response->printf("%s_us_count %u\n", name, t.count);
+  response->printf("# TYPE %s_min_us gauge\n", name);
+  response->printf("%s_min_us %u\n", name, t.min);
+  response->printf("# TYPE %s_max_us gauge\n", name);
+  response->printf("%s_max_us %u\n", name, t.max);
+}
+
+AsyncTCPMetrics::AsyncTCPMetrics(const String& uri)
+  : _uri(uri)
+{}
+
+bool AsyncTCPMetrics::canHandle(AsyncWebServerRequest *request){
+  return request->method() == HTTP_GET && request->url() == _uri;
+}
+
+void AsyncTCPMetrics::handleRequest(AsyncWebServerRequest *request){
+  async_tcp_stats_t stats;
+  async_tcp_get_stats(&stats);
+
+  AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+  response->print("# TYPE asynctcp_events_total counter\n");
+  for(int i = 0; i < ASYNC_TCP_EVENT_TYPES; i++){
+    response->printf("asynctcp_events_total{type=\"%s\"} %u\n", async_tcp_event_name(i), stats.events[i]);
+  }
+  response->printf("asynctcp_events_dropped_total %u\n", stats.events_dropped);
+  _printTiming(response, "asynctcp_event_time", stats.event_time);
+  _printTiming(response, "asynctcp_api_call_time", stats.api_call_time);
+  response->printf("asynctcp_queue_depth %u\n", stats.queue_depth);
+  response->printf("asynctcp_queue_depth_max %u\n", stats.queue_depth_max);
+  response->printf("asynctcp_closed_slots_used %u\n", stats.closed_slots_used);
+  response->printf("asynctcp_event_pool_misses_total %u\n", stats.event_pool_misses);
+  response->printf("asynctcp_client_pool_misses_total %u\n", stats.client_pool_misses);
+  request->send(response);
+}
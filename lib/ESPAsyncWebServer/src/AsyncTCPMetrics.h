@@ -0,0 +1,37 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef AsyncTCPMetrics_H_
+#define AsyncTCPMetrics_H_
+#include <ESPAsyncWebServer.h>
+
+// Exports the AsyncTCP statistics in the Prometheus text format.
+// Not added by default: server.addHandler(new AsyncTCPMetrics());
+class AsyncTCPMetrics: public AsyncWebHandler {
+  private:
+    String _uri;
+  public:
+    AsyncTCPMetrics(const String& uri=String("/metrics"));
+    virtual bool canHandle(AsyncWebServerRequest *request) override final;
+    virtual void handleRequest(AsyncWebServerRequest *request) override final;
+    virtual bool isRequestHandlerTrivial() override final {return true;}
+};
+
+#endif
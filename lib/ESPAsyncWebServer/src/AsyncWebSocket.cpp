@@ -491,6 +491,7 @@ AsyncWebSocketClient::AsyncWebSocketClient(AsyncWebServerRequest *request, Async
   _client->onAck([](void *r, AsyncClient* c, size_t len, uint32_t time){ (void)c; ((AsyncWebSocketClient*)(r))->_onAck(len, time); }, this);
   _client->onDisconnect([](void *r, AsyncClient* c){ ((AsyncWebSocketClient*)(r))->_onDisconnect(); delete c; }, this);
   _client->onTimeout([](void *r, AsyncClient* c, uint32_t time){ (void)c; ((AsyncWebSocketClient*)(r))->_onTimeout(time); }, this);
+  _client->onPacket(NULL, NULL);
   _client->onData([](void *r, AsyncClient* c, void *buf, size_t len){ (void)c; ((AsyncWebSocketClient*)(r))->_onData(buf, len); }, this);
   _client->onPoll([](void *r, AsyncClient* c){ (void)c; ((AsyncWebSocketClient*)(r))->_onPoll(); }, this);
   _server->_addClient(this);
@@ -1182,24 +1183,24 @@ bool AsyncWebSocket::canHandle(AsyncWebServerRequest *request){
 }
 
 void AsyncWebSocket::handleRequest(AsyncWebServerRequest *request){
-  if(!request->hasHeader(WS_STR_VERSION) || !request->hasHeader(WS_STR_KEY)){
+  if(!request->hasHeader(HEADER_SEC_WEBSOCKET_VERSION) || !request->hasHeader(HEADER_SEC_WEBSOCKET_KEY)){
     request->send(400);
     return;
   }
   if((_username != "" && _password != "") && !request->authenticate(_username.c_str(), _password.c_str())){
     return request->requestAuthentication();
   }
-  AsyncWebHeader* version = request->getHeader(WS_STR_VERSION);
+  AsyncWebHeader* version = request->getHeader(HEADER_SEC_WEBSOCKET_VERSION);
   if(version->value().toInt() != 13){
     AsyncWebServerResponse *response = request->beginResponse(400);
     response->addHeader(WS_STR_VERSION,"13");
     request->send(response);
     return;
   }
-  AsyncWebHeader* key = request->getHeader(WS_STR_KEY);
+  AsyncWebHeader* key = request->getHeader(HEADER_SEC_WEBSOCKET_KEY);
   AsyncWebServerResponse *response = new AsyncWebSocketResponse(key->value(), this);
-  if(request->hasHeader(WS_STR_PROTOCOL)){
-    AsyncWebHeader* protocol = request->getHeader(WS_STR_PROTOCOL);
+  if(request->hasHeader(HEADER_SEC_WEBSOCKET_PROTOCOL)){
+    AsyncWebHeader* protocol = request->getHeader(HEADER_SEC_WEBSOCKET_PROTOCOL);
     //ToDo: check protocol
     response->addHeader(WS_STR_PROTOCOL, protocol->value());
   }
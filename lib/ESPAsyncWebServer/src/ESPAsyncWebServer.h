@@ -56,6 +56,12 @@ class AsyncWebHandler;
 class AsyncStaticWebHandler;
 class AsyncCallbackWebHandler;
 class AsyncResponseStream;
+class AsyncWebRouteIndex;
+class AsyncWebBufferPool;
+class AsyncWebTemplate;
+class AsyncWebTemplateCache;
+class AsyncWebAssetCache;
+class AsyncWebAsset;
 
 #ifndef WEBSERVER_H
 typedef enum {
@@ -128,6 +134,63 @@ class AsyncWebHeader {
 
 typedef enum { RCT_NOT_USED = -1, RCT_DEFAULT = 0, RCT_HTTP, RCT_WS, RCT_EVENT, RCT_MAX } RequestedConnectionType;
 
+// Well-known request headers, located once at parse time and looked up by index
+typedef enum {
+  HEADER_HOST = 0,
+  HEADER_CONTENT_LENGTH,
+  HEADER_CONTENT_TYPE,
+  HEADER_CONNECTION,
+  HEADER_UPGRADE,
+  HEADER_AUTHORIZATION,
+  HEADER_EXPECT,
+  HEADER_ACCEPT,
+  HEADER_ACCEPT_ENCODING,
+  HEADER_IF_NONE_MATCH,
+  HEADER_IF_MODIFIED_SINCE,
+  HEADER_ORIGIN,
+  HEADER_COOKIE,
+  HEADER_LAST_EVENT_ID,
+  HEADER_SEC_WEBSOCKET_KEY,
+  HEADER_SEC_WEBSOCKET_VERSION,
+  HEADER_SEC_WEBSOCKET_PROTOCOL,
+  HEADER_MAX
+} WebRequestHeader;
+
+#define ASYNC_WEB_HEADER_BUCKETS 16 //hash chains for the other headers, power of two
+#define ASYNC_WEB_HEADER_NONE 0xFFFF
+
+#ifndef ASYNC_WEB_MAX_FORM_SIZE
+#define ASYNC_WEB_MAX_FORM_SIZE 8192 //larger url encoded bodies are refused with a 413
+#endif
+
+#ifndef ASYNC_WEB_MAX_HEADER_SIZE
+#define ASYNC_WEB_MAX_HEADER_SIZE 4096 //request line and headers, larger ones get a 431
+#endif
+
+#ifndef ASYNC_WEB_MAX_BODY_SIZE
+#define ASYNC_WEB_MAX_BODY_SIZE 0 //Content-Length above this gets a 413, 0 for no limit as bodies are streamed
+#endif
+
+#ifndef ASYNC_WEB_MAX_PARAMS
+#define ASYNC_WEB_MAX_PARAMS 32 //query, form and multipart parameters per request
+#endif
+
+#ifndef ASYNC_WEB_KEEPALIVE_TIMEOUT
+#define ASYNC_WEB_KEEPALIVE_TIMEOUT 15 //seconds an idle persistent connection waits for its next request
+#endif
+
+#ifndef ASYNC_WEB_MAX_PIPELINED
+#define ASYNC_WEB_MAX_PIPELINED 4096 //bytes of pipelined requests held while the current one is answered
+#endif
+
+#ifndef ASYNC_WEB_SEND_BUFFERS
+#define ASYNC_WEB_SEND_BUFFERS 6 //pooled send buffers shared by all responses, 0 always allocates
+#endif
+
+#ifndef ASYNC_WEB_SEND_BUFFER_SIZE
+#define ASYNC_WEB_SEND_BUFFER_SIZE (2 * TCP_MSS) //bytes in each pooled send buffer
+#endif
+
 typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
 typedef std::function<String(const String&)> AwsTemplateProcessor;
 
@@ -137,6 +200,8 @@ class AsyncWebServerRequest {
   friend class AsyncWebServer;
   friend class AsyncCallbackWebHandler;
   private:
+    // Headers, parameters and path parameters all live here and go away with the request
+    mutable AsyncWebArena _arena;
     AsyncClient* _client;
     AsyncWebServer* _server;
     AsyncWebHandler* _handler;
@@ -160,15 +225,65 @@ class AsyncWebServerRequest {
     bool _isMultipart;
     bool _isPlainPost;
     bool _expectingContinue;
+    bool _inCallback;
+    bool _pendingDisconnect;
+    // limits of the attached handler, or the server's until one is attached
+    size_t _maxBodySize;
+    size_t _maxParams;
+    int _rejectCode;  // a limit was hit, the request is refused at the next safe point
+    bool _keepAlive;  // the client wants the connection kept open
+    bool _persistent; // and the response allows it, the connection outlives this request
+    // requests that arrived on this connection before this one was answered
+    char *_pipelined;
+    size_t _pipelinedLen;
     size_t _contentLength;
     size_t _parsedLength;
 
-    LinkedList<AsyncWebHeader *> _headers;
-    LinkedList<AsyncWebParameter *> _params;
-    LinkedList<String *> _pathParams;
+    // The header section as received: one "name\0value\0" record per header,
+    // followed by the line still being received. AsyncWebHeader objects are
+    // only created for the headers a handler asks for.
+    char *_rawHeaders;
+    size_t _rawHeadersLen;
+    size_t _rawHeadersSize;
+    size_t _lineStart;
+    size_t _headerCount;
+    mutable AsyncWebHeader **_headerObjects;
+
+    // Index over the header records: the first occurrence of each well-known
+    // header by enum, every header through a case-insensitive hash
+    struct HeaderSlot {
+      uint32_t hash;
+      uint32_t offset;
+      uint16_t next;
+      bool keep;
+    };
+    HeaderSlot *_headerSlots;
+    size_t _headerSlotsSize;
+    uint16_t _headerBuckets[ASYNC_WEB_HEADER_BUCKETS];
+    uint16_t _knownHeaders[HEADER_MAX];
+    ArenaList<AsyncWebParameter *> _params;
+    ArenaList<String *> _pathParams;
+
+    // An url encoded body is copied here as it arrives and every field is
+    // decoded in place once its '&' is seen. The fields count as parameters
+    // after the query ones; an AsyncWebParameter is only made for a field
+    // when a handler asks for one.
+    struct FormField {
+      const char *name;
+      const char *value;
+      AsyncWebParameter *param;
+    };
+    char *_form;
+    size_t _formLen;
+    size_t _formStart;
+    ArenaList<FormField *> _formFields;
 
     uint8_t _multiParseState;
     uint8_t _boundaryPosition;
+    // "\r\n--boundary" and its Horspool skip table, so part data can be scanned a buffer at a time
+    uint8_t *_multipartDelimiter;
+    uint8_t *_multipartSkip;
+    size_t _multipartDelimiterLen;
     size_t _itemStartIndex;
     size_t _itemSize;
     String _itemName;
@@ -184,16 +299,37 @@ class AsyncWebServerRequest {
     void _onError(int8_t error);
     void _onTimeout(uint32_t time);
     void _onDisconnect();
+    void _onPacket(struct pbuf *pb);
+    void _onPipelined(char *buf, size_t len);
     void _onData(void *buf, size_t len);
+    void _ackResponse(size_t len, uint32_t time);
+    bool _stashPipelined(const char *data, size_t len);
+    bool _applyLimits();
+    void _reject(int code);
+    void _next();
 
     void _addParam(AsyncWebParameter*);
+    size_t _paramCount() const { return _params.length() + _formFields.length(); }
+    AsyncWebParameter* _formParam(FormField *f) const;
     void _addPathParam(const char *param);
 
-    bool _parseReqHead();
-    bool _parseReqHeader();
+    bool _appendRawHeaders(const char *data, size_t len);
+    void _resetHeaderIndex();
+    bool _indexHeader(size_t num, size_t offset, uint32_t hash, WebRequestHeader id);
+    size_t _findHeader(const char *name) const;
+    size_t _findHeader(WebRequestHeader id) const;
+    AsyncWebHeader* _headerObject(size_t num) const;
+
+    bool _parseReqHead(char *line, size_t len);
+    bool _parseReqHeader(char *line, size_t len);
     void _parseLine();
-    void _parsePlainPostChar(uint8_t data);
+    bool _parsePlainPost(const uint8_t *data, size_t len);
+    void _addFormField(char *field, size_t len);
     void _parseMultipartPostByte(uint8_t data, bool last);
+    void _parseMultipartPost(uint8_t *data, size_t len);
+    bool _prepareMultipartDelimiter();
+    size_t _multipartDataRun(const uint8_t *data, size_t len) const;
+    void _itemWriteRun(uint8_t *data, size_t len);
     void _addGetParams(const String& params);
 
     void _handleUploadStart();
@@ -220,6 +356,11 @@ class AsyncWebServerRequest {
     RequestedConnectionType requestedConnType() const { return _reqconntype; }
     bool isExpectedRequestedConnType(RequestedConnectionType erct1, RequestedConnectionType erct2 = RCT_NOT_USED, RequestedConnectionType erct3 = RCT_NOT_USED);
     void onDisconnect (ArDisconnectHandler fn);
+    bool keepAlive() const { return _keepAlive; }
+    bool _persist(bool framed); //called by the response before it assembles its head
+    AsyncWebBufferPool* _sendBuffers() const; //where the response takes its send buffers from
+    AsyncWebTemplateCache* _templateCache() const; //compiled templates of the server, may be NULL
+    AsyncWebAssetCache* _assetCache() const; //static files the server keeps in RAM, may be NULL
 
     //hash is the string representation of:
     // base64(user:pass) for basic or
@@ -253,13 +394,16 @@ class AsyncWebServerRequest {
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback=nullptr);
     AsyncWebServerResponse *beginResponse_P(int code, const String& contentType, PGM_P content, AwsTemplateProcessor callback=nullptr);
 
+    const AsyncWebArena& arena() const { return _arena; } // allocation counters for this request
     size_t headers() const;                     // get header count
     bool hasHeader(const String& name) const;   // check if header exists
     bool hasHeader(const __FlashStringHelper * data) const;   // check if header exists
+    bool hasHeader(WebRequestHeader id) const;  // check if a well-known header exists
 
     AsyncWebHeader* getHeader(const String& name) const;
     AsyncWebHeader* getHeader(const __FlashStringHelper * data) const;
     AsyncWebHeader* getHeader(size_t num) const;
+    AsyncWebHeader* getHeader(WebRequestHeader id) const;
 
     size_t params() const;                      // get arguments count
     bool hasParam(const String& name, bool post=false, bool file=false) const;
@@ -278,10 +422,12 @@ class AsyncWebServerRequest {
     bool hasArg(const __FlashStringHelper * data) const;         // check if F(argument) exists
 
     const String& ASYNCWEBSERVER_REGEX_ATTRIBUTE pathArg(size_t i) const;
+    const char * formArg(const char* name) const; // decoded url encoded body field without a copy, NULL if missing
 
     const String& header(const char* name) const;// get request header value by name
     const String& header(const __FlashStringHelper * data) const;// get request header value by F(name)    
     const String& header(size_t i) const;        // get request header value by number
+    const String& header(WebRequestHeader id) const; // get well-known request header value
     const String& headerName(size_t i) const;    // get request header name by number
     String urlDecode(const String& text) const;
 };
@@ -327,15 +473,32 @@ class AsyncWebRewrite {
  * HANDLER :: One instance can be attached to any Request (done by the Server)
  * */
 
+// How a handler's url can be indexed by the server
+typedef enum {
+  ROUTE_NONE,   // only canHandle() can tell
+  ROUTE_EXACT,  // the path itself and anything below it ("/path/...")
+  ROUTE_PREFIX  // any url starting with the path
+} WebRouteMatch;
+
 class AsyncWebHandler {
   protected:
     ArRequestFilterFunction _filter;
     String _username;
     String _password;
+    size_t _maxHeaderSize;
+    size_t _maxBodySize;
+    size_t _maxParams;
   public:
-    AsyncWebHandler():_username(""), _password(""){}
+    AsyncWebHandler():_username(""), _password(""), _maxHeaderSize(0), _maxBodySize(0), _maxParams(0){}
     AsyncWebHandler& setFilter(ArRequestFilterFunction fn) { _filter = fn; return *this; }
     AsyncWebHandler& setAuthentication(const char *username, const char *password){  _username = String(username);_password = String(password); return *this; };
+    // per route limits, 0 uses the server's. The header limit can only be tighter than the server's
+    AsyncWebHandler& setMaxHeaderSize(size_t max){ _maxHeaderSize = max; return *this; }
+    AsyncWebHandler& setMaxBodySize(size_t max){ _maxBodySize = max; return *this; }
+    AsyncWebHandler& setMaxParams(size_t max){ _maxParams = max; return *this; }
+    size_t maxHeaderSize() const { return _maxHeaderSize; }
+    size_t maxBodySize() const { return _maxBodySize; }
+    size_t maxParams() const { return _maxParams; }
     bool filter(AsyncWebServerRequest *request){ return _filter == NULL || _filter(request); }
     virtual ~AsyncWebHandler(){}
     virtual bool canHandle(AsyncWebServerRequest *request __attribute__((unused))){
@@ -345,6 +508,8 @@ class AsyncWebHandler {
     virtual void handleUpload(AsyncWebServerRequest *request  __attribute__((unused)), const String& filename __attribute__((unused)), size_t index __attribute__((unused)), uint8_t *data __attribute__((unused)), size_t len __attribute__((unused)), bool final  __attribute__((unused))){}
     virtual void handleBody(AsyncWebServerRequest *request __attribute__((unused)), uint8_t *data __attribute__((unused)), size_t len __attribute__((unused)), size_t index __attribute__((unused)), size_t total __attribute__((unused))){}
     virtual bool isRequestHandlerTrivial(){return true;}
+    // describes the urls canHandle() can accept, so the server only asks the handlers that may match
+    virtual WebRouteMatch route(String& path __attribute__((unused)), WebRequestMethodComposite& methods __attribute__((unused))){ return ROUTE_NONE; }
 };
 
 /*
@@ -386,6 +551,33 @@ class AsyncWebServerResponse {
     virtual size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
 };
 
+/*
+ * SEND BUFFER POOL :: Shared by the responses of one server
+ * */
+
+class AsyncWebBufferPool {
+  private:
+    uint8_t** _buffers; //every buffer taken from the heap, the idle ones first
+    size_t _count;
+    size_t _size;
+    size_t _allocated;
+    size_t _idle;
+    portMUX_TYPE _lock;
+    void _free();
+  public:
+    AsyncWebBufferPool(size_t count, size_t size);
+    ~AsyncWebBufferPool();
+
+    bool configure(size_t count, size_t size); //fails while a buffer is still in flight
+    uint8_t* acquire(); //NULL when every buffer is in flight
+    void release(const uint8_t* data); //any pointer into an acquired buffer
+    size_t count() const { return _count; }
+    size_t size() const { return _size; }
+    size_t available();
+
+    static void onRelease(void* arg, const char* data, size_t len); //AcBufferReleaseHandler, arg is the pool
+};
+
 /*
  * SERVER :: One instance
  * */
@@ -400,6 +592,15 @@ class AsyncWebServer {
     LinkedList<AsyncWebRewrite*> _rewrites;
     LinkedList<AsyncWebHandler*> _handlers;
     AsyncCallbackWebHandler* _catchAllHandler;
+    AsyncWebRouteIndex* _routes;
+    size_t _maxFormSize;
+    size_t _maxHeaderSize;
+    size_t _maxBodySize;
+    size_t _maxParams;
+    uint16_t _keepAliveTimeout;
+    AsyncWebBufferPool _sendBuffers;
+    AsyncWebTemplateCache* _templates;
+    AsyncWebAssetCache* _assets;
 
   public:
     AsyncWebServer(uint16_t port);
@@ -408,6 +609,26 @@ class AsyncWebServer {
     void begin();
     void end();
 
+    void setBacklog(uint8_t backlog); //set before begin()
+    void setMaxClients(uint16_t max); //connections above this get a 503 without allocating a request, 0 for no limit
+    void setAcceptRate(uint16_t per_second, uint16_t burst = 1); //new connections above this rate get a 503 as well
+    void setMaxFormSize(size_t max){ _maxFormSize = max; } //url encoded bodies above this get a 413 before anything is allocated
+    size_t maxFormSize() const { return _maxFormSize; }
+    void setMaxHeaderSize(size_t max){ _maxHeaderSize = max; } //request line and headers above this get a 431 while still arriving
+    void setMaxBodySize(size_t max){ _maxBodySize = max; } //Content-Length above this gets a 413 before the body is read, 0 for no limit
+    void setMaxParams(size_t max){ _maxParams = max; } //more parameters than this get a 413 (414 in the query), 0 for no limit
+    size_t maxHeaderSize() const { return _maxHeaderSize; }
+    size_t maxBodySize() const { return _maxBodySize; }
+    size_t maxParams() const { return _maxParams; }
+    void setKeepAliveTimeout(uint16_t seconds){ _keepAliveTimeout = seconds; } //idle timeout of persistent connections, 0 closes after every response
+    uint16_t keepAliveTimeout() const { return _keepAliveTimeout; }
+    bool setSendBuffers(size_t count, size_t size = ASYNC_WEB_SEND_BUFFER_SIZE){ return _sendBuffers.configure(count, size); } //set before begin(), 0 buffers always allocates
+    AsyncWebBufferPool& sendBuffers(){ return _sendBuffers; }
+    void setTemplateCache(size_t templates); //compiled template files kept in RAM, 0 expands them while streaming
+    AsyncWebTemplateCache* templateCache(){ return _templates; }
+    void setAssetCache(size_t bytes, size_t maxFileSize); //static files up to maxFileSize are served from RAM, 0 bytes turns it off
+    AsyncWebAssetCache* assetCache(){ return _assets; }
+
 #if ASYNC_TCP_SSL_ENABLED
     void onSslFileRequest(AcSSlFileHandler cb, void* arg);
     void beginSecure(const char *cert, const char *private_key_file, const char *password);
@@ -1,4 +1,6 @@
 #include "SPIFFSEditor.h"
+#include "WebTemplate.h"
+#include "WebAssetCache.h"
 #include <FS.h>
 
 //File: edit.htm.gz, Size: 4151
@@ -485,7 +487,7 @@ void SPIFFSEditor::handleRequest(AsyncWebServerRequest *request){
     }
     else {
       const char * buildTime = __DATE__ " " __TIME__ " GMT";
-      if (request->header("If-Modified-Since").equals(buildTime)) {
+      if (request->header(HEADER_IF_MODIFIED_SINCE).equals(buildTime)) {
         request->send(304);
       } else {
         AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", edit_htm_gz, edit_htm_gz_len);
@@ -497,6 +499,10 @@ void SPIFFSEditor::handleRequest(AsyncWebServerRequest *request){
   } else if(request->method() == HTTP_DELETE){
     if(request->hasParam("path", true)){
         _fs.remove(request->getParam("path", true)->value());
+        if(request->_templateCache())
+          request->_templateCache()->invalidate(request->getParam("path", true)->value());
+        if(request->_assetCache())
+          request->_assetCache()->invalidate(request->getParam("path", true)->value());
       request->send(200, "", "DELETE: "+request->getParam("path", true)->value());
     } else
       request->send(404);
@@ -515,6 +521,10 @@ void SPIFFSEditor::handleRequest(AsyncWebServerRequest *request){
         if(f){
           f.write((uint8_t)0x00);
           f.close();
+          if(request->_templateCache())
+            request->_templateCache()->invalidate(filename);
+          if(request->_assetCache())
+            request->_assetCache()->invalidate(filename);
           request->send(200, "", "CREATE: "+filename);
         } else {
           request->send(500);
@@ -539,6 +549,12 @@ void SPIFFSEditor::handleUpload(AsyncWebServerRequest *request, const String& fi
     }
     if(final){
       request->_tempFile.close();
+      // a compiled template of the old file would cut the new one at the wrong places,
+      // a cached copy would keep serving the old one
+      if(request->_templateCache())
+        request->_templateCache()->invalidate(filename);
+      if(request->_assetCache())
+        request->_assetCache()->invalidate(filename);
     }
   }
 }
@@ -23,6 +23,13 @@
 
 #include "stddef.h"
 #include "WString.h"
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#ifndef ASYNC_WEB_ARENA_INLINE
+#define ASYNC_WEB_ARENA_INLINE 512
+#endif
 
 template <typename T>
 class LinkedListNode {
@@ -172,6 +179,167 @@ class LinkedList {
 };
 
 
+/*
+ * Bump allocator for objects that live exactly as long as their owner.
+ * The first block is inline, further blocks are chained on the heap and
+ * everything is given back at once; destructors run in reverse order.
+ * */
+
+class AsyncWebArena {
+  private:
+    struct Block {
+      Block* next;
+      size_t size;
+      size_t used;
+    };
+    struct Finalizer {
+      Finalizer* next;
+      void (*destroy)(void*);
+      void* object;
+    };
+    static const size_t _blockHeader = (sizeof(Block) + 7) & ~(size_t)7;
+
+    alignas(8) uint8_t _inline[ASYNC_WEB_ARENA_INLINE];
+    size_t _inlineUsed;
+    Block* _blocks;
+    Finalizer* _finalizers;
+    size_t _allocations;
+    size_t _heapBlocks;
+
+    template<typename T> static void _destroy(void* object){ static_cast<T*>(object)->~T(); }
+
+  public:
+    AsyncWebArena() : _inlineUsed(0), _blocks(nullptr), _finalizers(nullptr), _allocations(0), _heapBlocks(0) {}
+    AsyncWebArena(const AsyncWebArena&) = delete;
+    AsyncWebArena& operator=(const AsyncWebArena&) = delete;
+    ~AsyncWebArena(){ clear(); }
+
+    void* alloc(size_t size){
+      size = (size + 7) & ~(size_t)7;
+      _allocations++;
+      if(_inlineUsed + size <= sizeof(_inline)){
+        void* p = _inline + _inlineUsed;
+        _inlineUsed += size;
+        return p;
+      }
+      if(!_blocks || _blocks->used + size > _blocks->size){
+        size_t blockSize = (size > ASYNC_WEB_ARENA_INLINE) ? size : ASYNC_WEB_ARENA_INLINE;
+        Block* b = (Block*)malloc(_blockHeader + blockSize);
+        if(!b){
+          return nullptr;
+        }
+        b->next = _blocks;
+        b->size = blockSize;
+        b->used = 0;
+        _blocks = b;
+        _heapBlocks++;
+      }
+      void* p = (uint8_t*)_blocks + _blockHeader + _blocks->used;
+      _blocks->used += size;
+      return p;
+    }
+
+    template<typename T, typename... Args> T* make(Args&&... args){
+      void* p = alloc(sizeof(T));
+      if(!p){
+        return nullptr;
+      }
+      T* t = new (p) T(std::forward<Args>(args)...);
+      if(!std::is_trivially_destructible<T>::value){
+        Finalizer* f = (Finalizer*)alloc(sizeof(Finalizer));
+        if(!f){
+          t->~T();
+          return nullptr;
+        }
+        f->next = _finalizers;
+        f->destroy = &_destroy<T>;
+        f->object = t;
+        _finalizers = f;
+      }
+      return t;
+    }
+
+    void clear(){
+      while(_finalizers){
+        Finalizer* f = _finalizers;
+        _finalizers = f->next;
+        f->destroy(f->object);
+      }
+      while(_blocks){
+        Block* b = _blocks;
+        _blocks = b->next;
+        ::free(b);
+      }
+      _inlineUsed = 0;
+    }
+
+    size_t allocations() const { return _allocations; } // objects and buffers handed out
+    size_t heapBlocks() const { return _heapBlocks; }   // of those, the ones that needed a malloc
+};
+
+/*
+ * Append only list with its nodes in an AsyncWebArena
+ * */
+
+template <typename T>
+class ArenaList {
+  private:
+    struct Node {
+      T value;
+      Node* next;
+      Node(const T& v): value(v), next(nullptr) {}
+    };
+    Node* _root;
+    Node* _last;
+    size_t _length;
+
+    class Iterator {
+      Node* _node;
+    public:
+      Iterator(Node* current = nullptr) : _node(current) {}
+      Iterator(const Iterator& i) : _node(i._node) {}
+      Iterator& operator ++() { _node = _node->next; return *this; }
+      bool operator != (const Iterator& i) const { return _node != i._node; }
+      const T& operator * () const { return _node->value; }
+      const T* operator -> () const { return &_node->value; }
+    };
+
+  public:
+    typedef const Iterator ConstIterator;
+    ConstIterator begin() const { return ConstIterator(_root); }
+    ConstIterator end() const { return ConstIterator(nullptr); }
+
+    ArenaList() : _root(nullptr), _last(nullptr), _length(0) {}
+    bool add(AsyncWebArena& arena, const T& t){
+      Node* n = arena.make<Node>(t);
+      if(!n){
+        return false;
+      }
+      if(_last){
+        _last->next = n;
+      } else {
+        _root = n;
+      }
+      _last = n;
+      _length++;
+      return true;
+    }
+    size_t length() const {
+      return _length;
+    }
+    const T* nth(size_t N) const {
+      if(N >= _length){
+        return nullptr;
+      }
+      Node* it = _root;
+      while(N--){
+        it = it->next;
+      }
+      return &(it->value);
+    }
+};
+
+
 class StringArray : public LinkedList<String> {
 public:
   
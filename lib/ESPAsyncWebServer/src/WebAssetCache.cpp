@@ -0,0 +1,166 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "WebAssetCache.h"
+
+/*
+ * Asset
+ * */
+
+AsyncWebAsset::AsyncWebAsset(const String& path, const String& file, uint8_t* data, size_t size, bool gzip)
+  : _path(path)
+  , _file(file)
+  , _data(data)
+  , _size(size)
+  , _gzip(gzip)
+  , _refs(0)
+  , _used(0)
+{
+  // FNV-1a over the content, so the tag only changes when the bytes do
+  uint32_t hash = 2166136261UL;
+  for(size_t i = 0; i < _size; i++){
+    hash ^= _data[i];
+    hash *= 16777619UL;
+  }
+  char etag[20];
+  snprintf(etag, sizeof(etag), "\"%x-%08x\"", (unsigned int)_size, (unsigned int)hash);
+  _etag = String(etag);
+}
+
+AsyncWebAsset::~AsyncWebAsset(){
+  free(_data);
+}
+
+bool AsyncWebAsset::matches(const String& etags) const {
+  return etags == "*" || etags.indexOf(_etag) >= 0;
+}
+
+void AsyncWebAsset::onRelease(void* arg, const char* data, size_t len){
+  (void)data;
+  (void)len;
+  ((AsyncWebAsset*)arg)->release();
+}
+
+/*
+ * Asset Cache
+ * */
+
+AsyncWebAssetCache::AsyncWebAssetCache(size_t capacity, size_t maxSize)
+  : _assets(LinkedList<AsyncWebAsset*>([](AsyncWebAsset* a){ a->release(); }))
+  , _capacity(capacity)
+  , _maxSize(maxSize)
+  , _bytes(0)
+  , _clock(0)
+{}
+
+AsyncWebAssetCache::~AsyncWebAssetCache(){
+  clear();
+}
+
+AsyncWebAsset* AsyncWebAssetCache::_find(const String& path) const {
+  for(const auto& a: _assets){
+    if(a->path() == path)
+      return a;
+  }
+  return NULL;
+}
+
+bool AsyncWebAssetCache::_remove(AsyncWebAsset* asset){
+  if(asset == NULL)
+    return false;
+  _bytes -= asset->size();
+  return _assets.remove(asset);
+}
+
+bool AsyncWebAssetCache::_removeFirst(LinkedList<AsyncWebAsset*>::Predicate predicate){
+  for(const auto& a: _assets){
+    if(predicate(a))
+      return _remove(a);
+  }
+  return false;
+}
+
+void AsyncWebAssetCache::_evict(size_t capacity){
+  while(_bytes > capacity){
+    AsyncWebAsset* oldest = _assets.front();
+    for(const auto& a: _assets){
+      if((int32_t)(a->_used - oldest->_used) < 0)
+        oldest = a;
+    }
+    _remove(oldest);
+  }
+}
+
+AsyncWebAsset* AsyncWebAssetCache::get(const String& path){
+  AsyncWebAsset* asset = _find(path);
+  if(asset == NULL)
+    return NULL;
+  asset->_used = ++_clock;
+  return asset->retain();
+}
+
+AsyncWebAsset* AsyncWebAssetCache::add(const String& path, fs::File& file){
+  if(!file)
+    return NULL;
+  const size_t size = file.size();
+  if(size == 0 || size > _maxSize || size > _capacity)
+    return NULL;
+  uint8_t* data = (uint8_t*)malloc(size);
+  if(data == NULL)
+    return NULL;
+  size_t readLen = 0;
+  while(readLen < size){
+    size_t r = file.read(data + readLen, size - readLen);
+    if(r == 0)
+      break;
+    readLen += r;
+  }
+  // the same test AsyncFileResponse makes to send a gzipped file as such
+  const bool gzip = String(file.name()).endsWith(".gz") && !path.endsWith(".gz");
+  AsyncWebAsset* asset = (readLen == size) ? new AsyncWebAsset(path, gzip ? path + ".gz" : path, data, size, gzip) : NULL;
+  if(asset == NULL){
+    free(data);
+    file.seek(0);
+    return NULL;
+  }
+
+  _remove(_find(path));
+  _evict(_capacity - size);
+  asset->_used = ++_clock;
+  _assets.add(asset->retain());
+  _bytes += size;
+  return asset->retain();
+}
+
+void AsyncWebAssetCache::invalidate(const String& path){
+  while(_removeFirst([&](AsyncWebAsset* const& a){ return a->path() == path || a->file() == path; }));
+}
+
+void AsyncWebAssetCache::clear(){
+  _assets.free();
+  _bytes = 0;
+}
+
+void AsyncWebAssetCache::setCapacity(size_t capacity, size_t maxSize){
+  _capacity = capacity;
+  _maxSize = maxSize;
+  _evict(_capacity);
+  while(_removeFirst([&](AsyncWebAsset* const& a){ return a->size() > _maxSize; }));
+}
@@ -0,0 +1,102 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBASSETCACHE_H_
+#define ASYNCWEBASSETCACHE_H_
+
+#include "ESPAsyncWebServer.h"
+
+#ifndef ASYNC_WEB_ASSET_CACHE
+#define ASYNC_WEB_ASSET_CACHE 16384 //bytes of static files kept in RAM, 0 always reads the file system
+#endif
+
+#ifndef ASYNC_WEB_ASSET_MAX_SIZE
+#define ASYNC_WEB_ASSET_MAX_SIZE 4096 //larger files are always read from the file system
+#endif
+
+/*
+ * ASSET :: The content of a small static file with a strong ETag over it.
+ * Responses and the buffers they queue hold references, the cache may drop it before they are done.
+ * */
+
+class AsyncWebAsset {
+  private:
+    String _path; //as requested, without .gz
+    String _file; //as stored
+    uint8_t* _data;
+    size_t _size;
+    String _etag;
+    bool _gzip;
+    uint16_t _refs;
+    uint32_t _used;
+
+  public:
+    AsyncWebAsset(const String& path, const String& file, uint8_t* data, size_t size, bool gzip);
+    ~AsyncWebAsset();
+
+    const String& path() const { return _path; }
+    const String& file() const { return _file; }
+    const uint8_t* data() const { return _data; }
+    size_t size() const { return _size; }
+    const String& etag() const { return _etag; }
+    bool gzip() const { return _gzip; }
+    bool matches(const String& etags) const; //value of an If-None-Match header
+
+    AsyncWebAsset* retain(){ _refs++; return this; }
+    void release(){ if(--_refs == 0) delete this; }
+    static void onRelease(void* arg, const char* data, size_t len); //AcBufferReleaseHandler, arg is the asset
+    friend class AsyncWebAssetCache;
+};
+
+/*
+ * ASSET CACHE :: Hot static files of one server, least recently used goes first.
+ * Files changed behind the server's back have to be invalidated by whoever changes them.
+ * */
+
+class AsyncWebAssetCache {
+  private:
+    LinkedList<AsyncWebAsset*> _assets;
+    size_t _capacity;
+    size_t _maxSize;
+    size_t _bytes;
+    uint32_t _clock;
+
+    AsyncWebAsset* _find(const String& path) const;
+    void _evict(size_t capacity);
+    bool _remove(AsyncWebAsset* asset);
+    bool _removeFirst(LinkedList<AsyncWebAsset*>::Predicate predicate);
+
+  public:
+    AsyncWebAssetCache(size_t capacity, size_t maxSize);
+    ~AsyncWebAssetCache();
+
+    bool contains(const String& path) const { return _find(path) != NULL; }
+    AsyncWebAsset* get(const String& path); //retained for the caller, NULL if not cached
+    // reads a file that fits into the cache, retained for the caller. NULL leaves the file where it was
+    AsyncWebAsset* add(const String& path, fs::File& file);
+    void invalidate(const String& path); //the requested path or the stored file name
+    void clear();
+    void setCapacity(size_t capacity, size_t maxSize);
+    size_t capacity() const { return _capacity; }
+    size_t maxSize() const { return _maxSize; }
+    size_t bytes() const { return _bytes; }
+};
+
+#endif /* ASYNCWEBASSETCACHE_H_ */
@@ -35,6 +35,7 @@ class AsyncStaticWebHandler: public AsyncWebHandler {
   private:
     bool _getFile(AsyncWebServerRequest *request);
     bool _fileExists(AsyncWebServerRequest *request, const String& path);
+    bool _assetCached(AsyncWebServerRequest *request, const String& path);
     uint8_t _countBits(const uint8_t value) const;
   protected:
     FS _fs;
@@ -51,6 +52,11 @@ class AsyncStaticWebHandler: public AsyncWebHandler {
     AsyncStaticWebHandler(const char* uri, FS& fs, const char* path, const char* cache_control);
     virtual bool canHandle(AsyncWebServerRequest *request) override final;
     virtual void handleRequest(AsyncWebServerRequest *request) override final;
+    virtual WebRouteMatch route(String& path, WebRequestMethodComposite& methods) override final {
+      path = _uri;
+      methods = HTTP_GET;
+      return ROUTE_PREFIX;
+    }
     AsyncStaticWebHandler& setIsDir(bool isDir);
     AsyncStaticWebHandler& setDefaultFile(const char* filename);
     AsyncStaticWebHandler& setCacheControl(const char* cache_control);
@@ -146,6 +152,18 @@ class AsyncCallbackWebHandler: public AsyncWebHandler {
         _onBody(request, data, len, index, total);
     }
     virtual bool isRequestHandlerTrivial() override final {return _onRequest ? false : true;}
+    virtual WebRouteMatch route(String& path, WebRequestMethodComposite& methods) override final {
+      if(_isRegex || _uri.startsWith("/*."))
+        return ROUTE_NONE;
+      methods = _method;
+      if(_uri.endsWith("*")){
+        path = _uri.substring(0, _uri.length() - 1);
+        return ROUTE_PREFIX;
+      }
+      path = _uri;
+      // an empty uri takes every request
+      return _uri.length() ? ROUTE_EXACT : ROUTE_PREFIX;
+    }
 };
 
 #endif /* ASYNCWEBSERVERHANDLERIMPL_H_ */
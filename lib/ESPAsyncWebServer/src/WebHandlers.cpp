@@ -20,6 +20,7 @@
 */
 #include "ESPAsyncWebServer.h"
 #include "WebHandlerImpl.h"
+#include "WebAssetCache.h"
 
 AsyncStaticWebHandler::AsyncStaticWebHandler(const char* uri, FS& fs, const char* path, const char* cache_control)
   : _fs(fs), _uri(uri), _path(path), _default_file("index.htm"), _cache_control(cache_control), _last_modified(""), _callback(nullptr)
@@ -92,7 +93,8 @@ bool AsyncStaticWebHandler::canHandle(AsyncWebServerRequest *request){
     if (_last_modified.length())
       request->addInterestingHeader("If-Modified-Since");
 
-    if(_cache_control.length())
+    // files served from RAM always carry an ETag
+    if(_cache_control.length() || (!_callback && request->_assetCache()))
       request->addInterestingHeader("If-None-Match");
 
     DEBUGF("[AsyncStaticWebHandler::canHandle] TRUE\n");
@@ -113,7 +115,7 @@ bool AsyncStaticWebHandler::_getFile(AsyncWebServerRequest *request)
   path = _path + path;
 
   // Do we have a file or .gz file
-  if (!canSkipFileCheck && _fileExists(request, path))
+  if (!canSkipFileCheck && (_assetCached(request, path) || _fileExists(request, path)))
     return true;
 
   // Can't handle if not default file
@@ -125,7 +127,22 @@ bool AsyncStaticWebHandler::_getFile(AsyncWebServerRequest *request)
     path += "/";
   path += _default_file;
 
-  return _fileExists(request, path);
+  return _assetCached(request, path) || _fileExists(request, path);
+}
+
+bool AsyncStaticWebHandler::_assetCached(AsyncWebServerRequest *request, const String& path)
+{
+  // Templates are expanded per request, their output is never cached
+  AsyncWebAssetCache* assets = _callback ? NULL : request->_assetCache();
+  if (assets == NULL || !assets->contains(path))
+    return false;
+
+  // Keep the path in _tempObject just like _fileExists() does
+  size_t pathLen = path.length();
+  char * _tempPath = (char*)malloc(pathLen+1);
+  snprintf(_tempPath, pathLen+1, "%s", path.c_str());
+  request->_tempObject = (void*)_tempPath;
+  return true;
 }
 
 #ifdef ESP32
@@ -193,12 +210,50 @@ void AsyncStaticWebHandler::handleRequest(AsyncWebServerRequest *request)
   if((_username != "" && _password != "") && !request->authenticate(_username.c_str(), _password.c_str()))
       return request->requestAuthentication();
 
-  if (request->_tempFile == true) {
+  // Small files are read into RAM once, later requests never reach the file system
+  AsyncWebAssetCache* assets = _callback ? NULL : request->_assetCache();
+  AsyncWebAsset* asset = NULL;
+  if (assets != NULL) {
+    if (request->_tempFile == true) {
+      asset = assets->add(filename, request->_tempFile);
+      if (asset != NULL)
+        request->_tempFile.close();
+    } else {
+      asset = assets->get(filename);
+      // dropped since canHandle(), the file is opened after all
+      if (asset == NULL && _fileExists(request, filename)) {
+        free(request->_tempObject);
+        request->_tempObject = NULL;
+      }
+    }
+  }
+
+  if (asset != NULL) {
+    if (_last_modified.length() && _last_modified == request->header(HEADER_IF_MODIFIED_SINCE)) {
+      asset->release();
+      request->send(304); // Not modified
+    } else if (request->hasHeader(HEADER_IF_NONE_MATCH) && asset->matches(request->header(HEADER_IF_NONE_MATCH))) {
+      AsyncWebServerResponse * response = new AsyncBasicResponse(304); // Not modified
+      response->addHeader("ETag", asset->etag());
+      if (_cache_control.length())
+        response->addHeader("Cache-Control", _cache_control);
+      asset->release();
+      request->send(response);
+    } else {
+      AsyncWebServerResponse * response = new AsyncAssetResponse(asset);
+      if (_last_modified.length())
+        response->addHeader("Last-Modified", _last_modified);
+      if (_cache_control.length())
+        response->addHeader("Cache-Control", _cache_control);
+      response->addHeader("ETag", asset->etag());
+      request->send(response);
+    }
+  } else if (request->_tempFile == true) {
     String etag = String(request->_tempFile.size());
-    if (_last_modified.length() && _last_modified == request->header("If-Modified-Since")) {
+    if (_last_modified.length() && _last_modified == request->header(HEADER_IF_MODIFIED_SINCE)) {
       request->_tempFile.close();
       request->send(304); // Not modified
-    } else if (_cache_control.length() && request->hasHeader("If-None-Match") && request->header("If-None-Match").equals(etag)) {
+    } else if (_cache_control.length() && request->hasHeader(HEADER_IF_NONE_MATCH) && request->header(HEADER_IF_NONE_MATCH).equals(etag)) {
       request->_tempFile.close();
       AsyncWebServerResponse * response = new AsyncBasicResponse(304); // Not modified
       response->addHeader("Cache-Control", _cache_control);
@@ -32,8 +32,52 @@ static const String SharedEmptyString = String();
 
 enum { PARSE_REQ_START, PARSE_REQ_HEADERS, PARSE_REQ_BODY, PARSE_REQ_END, PARSE_REQ_FAIL };
 
+/*
+ * Header name hashing
+ * */
+
+// FNV-1a over the name with the ASCII case bit forced on, so names that only
+// differ in case hash alike. Matches are still confirmed with strcasecmp.
+static constexpr uint32_t headerNameHash(const char *name, uint32_t hash = 2166136261u){
+  return *name ? headerNameHash(name + 1, (hash ^ ((uint8_t)*name | 0x20)) * 16777619u) : hash;
+}
+
+static uint32_t headerHash(const char *name){
+  uint32_t hash = 2166136261u;
+  while(*name){
+    hash = (hash ^ ((uint8_t)*name++ | 0x20)) * 16777619u;
+  }
+  return hash;
+}
+
+// indexed by WebRequestHeader
+static const char * const knownHeaderNames[HEADER_MAX] = {
+  "Host", "Content-Length", "Content-Type", "Connection", "Upgrade", "Authorization",
+  "Expect", "Accept", "Accept-Encoding", "If-None-Match", "If-Modified-Since", "Origin",
+  "Cookie", "Last-Event-ID", "Sec-WebSocket-Key", "Sec-WebSocket-Version", "Sec-WebSocket-Protocol"
+};
+
+static constexpr uint32_t knownHeaderHashes[HEADER_MAX] = {
+  headerNameHash("Host"), headerNameHash("Content-Length"), headerNameHash("Content-Type"),
+  headerNameHash("Connection"), headerNameHash("Upgrade"), headerNameHash("Authorization"),
+  headerNameHash("Expect"), headerNameHash("Accept"), headerNameHash("Accept-Encoding"),
+  headerNameHash("If-None-Match"), headerNameHash("If-Modified-Since"), headerNameHash("Origin"),
+  headerNameHash("Cookie"), headerNameHash("Last-Event-ID"), headerNameHash("Sec-WebSocket-Key"),
+  headerNameHash("Sec-WebSocket-Version"), headerNameHash("Sec-WebSocket-Protocol")
+};
+
+static WebRequestHeader knownHeader(const char *name, uint32_t hash){
+  for(int id = 0; id < HEADER_MAX; ++ id){
+    if(knownHeaderHashes[id] == hash && !strcasecmp(name, knownHeaderNames[id])){
+      return (WebRequestHeader)id;
+    }
+  }
+  return HEADER_MAX;
+}
+
 AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
-  : _client(c)
+  : _arena()
+  , _client(c)
   , _server(s)
   , _handler(NULL)
   , _response(NULL)
@@ -51,13 +95,36 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _isMultipart(false)
   , _isPlainPost(false)
   , _expectingContinue(false)
+  , _inCallback(false)
+  , _pendingDisconnect(false)
+  , _maxBodySize(s->maxBodySize())
+  , _maxParams(s->maxParams())
+  , _rejectCode(0)
+  , _keepAlive(false)
+  , _persistent(false)
+  , _pipelined(NULL)
+  , _pipelinedLen(0)
   , _contentLength(0)
   , _parsedLength(0)
-  , _headers(LinkedList<AsyncWebHeader *>([](AsyncWebHeader *h){ delete h; }))
-  , _params(LinkedList<AsyncWebParameter *>([](AsyncWebParameter *p){ delete p; }))
-  , _pathParams(LinkedList<String *>([](String *p){ delete p; }))
+  , _rawHeaders(NULL)
+  , _rawHeadersLen(0)
+  , _rawHeadersSize(0)
+  , _lineStart(0)
+  , _headerCount(0)
+  , _headerObjects(NULL)
+  , _headerSlots(NULL)
+  , _headerSlotsSize(0)
+  , _params()
+  , _pathParams()
+  , _form(NULL)
+  , _formLen(0)
+  , _formStart(0)
+  , _formFields()
   , _multiParseState(0)
   , _boundaryPosition(0)
+  , _multipartDelimiter(NULL)
+  , _multipartSkip(NULL)
+  , _multipartDelimiterLen(0)
   , _itemStartIndex(0)
   , _itemSize(0)
   , _itemName()
@@ -69,20 +136,16 @@ AsyncWebServerRequest::AsyncWebServerRequest(AsyncWebServer* s, AsyncClient* c)
   , _itemIsFile(false)
   , _tempObject(NULL)
 {
+  _resetHeaderIndex();
   c->onError([](void *r, AsyncClient* c, int8_t error){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onError(error); }, this);
   c->onAck([](void *r, AsyncClient* c, size_t len, uint32_t time){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onAck(len, time); }, this);
-  c->onDisconnect([](void *r, AsyncClient* c){ AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onDisconnect(); delete c; }, this);
+  c->onDisconnect([](void *r, AsyncClient* c){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onDisconnect(); }, this);
   c->onTimeout([](void *r, AsyncClient* c, uint32_t time){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onTimeout(time); }, this);
-  c->onData([](void *r, AsyncClient* c, void *buf, size_t len){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onData(buf, len); }, this);
-  c->onPoll([](void *r, AsyncClient* c){ (void)c; AsyncWebServerRequest *req = ( AsyncWebServerRequest*)r; req->_onPoll(); }, this);
+  c->onPacket([](void *r, AsyncClient* c, struct pbuf *pb){ (void)c; AsyncWebServerRequest *req = (AsyncWebServerRequest*)r; req->_onPacket(pb); }, this);
 }
 
 AsyncWebServerRequest::~AsyncWebServerRequest(){
-  _headers.free();
-
-  _params.free();
-  _pathParams.free();
-
+  // headers, params and path params are released with _arena
   _interestingHeaders.free();
 
   if(_response != NULL){
@@ -96,30 +159,119 @@ AsyncWebServerRequest::~AsyncWebServerRequest(){
   if(_tempFile){
     _tempFile.close();
   }
+
+  free(_pipelined);
+}
+
+void AsyncWebServerRequest::_onPacket(struct pbuf *pb){
+  // Parse every segment of the chain in place and only reopen the receive
+  // window once the parser is done with all of them. Tearing down the
+  // request is postponed until then, as the chain still has to be acked.
+  _inCallback = true;
+  for(struct pbuf *q = pb; q != NULL && !_pendingDisconnect; q = q->next){
+    if(q->len){
+      _onData(q->payload, q->len);
+    }
+  }
+  _inCallback = false;
+  _client->ackPacket(pb);
+  if(_pendingDisconnect){
+    _onDisconnect();
+  }
+}
+
+void AsyncWebServerRequest::_onPipelined(char *buf, size_t len){
+  _inCallback = true;
+  _onData(buf, len);
+  _inCallback = false;
+  if(_pendingDisconnect){
+    _onDisconnect();
+  }
+}
+
+bool AsyncWebServerRequest::_stashPipelined(const char *data, size_t len){
+  if(!_keepAlive){
+    // the connection is closed after the response, nothing will read these
+    return true;
+  }
+  if(_pipelinedLen + len > ASYNC_WEB_MAX_PIPELINED){
+    return false;
+  }
+  char *grown = (char*)realloc(_pipelined, _pipelinedLen + len);
+  if(grown == NULL){
+    return false;
+  }
+  memcpy(grown + _pipelinedLen, data, len);
+  _pipelined = grown;
+  _pipelinedLen += len;
+  return true;
+}
+
+bool AsyncWebServerRequest::_persist(bool framed){
+  // a response sent before the body is in would leave the rest of it on the connection
+  _persistent = framed && _keepAlive && _parseState == PARSE_REQ_END && _server->keepAliveTimeout();
+  return _persistent;
+}
+
+AsyncWebBufferPool* AsyncWebServerRequest::_sendBuffers() const {
+  return _server ? &_server->sendBuffers() : NULL;
+}
+
+AsyncWebTemplateCache* AsyncWebServerRequest::_templateCache() const {
+  return _server ? _server->templateCache() : NULL;
+}
+
+AsyncWebAssetCache* AsyncWebServerRequest::_assetCache() const {
+  return _server ? _server->assetCache() : NULL;
+}
+
+void AsyncWebServerRequest::_next(){
+  // The response is out, the connection carries on with a fresh request
+  AsyncClient* c = _client;
+  AsyncWebServerRequest *r = new AsyncWebServerRequest(_server, c);
+  if(r == NULL){
+    c->close(true);
+    return;
+  }
+  c->onPoll(NULL, NULL);
+  c->setRxTimeout(_server->keepAliveTimeout());
+  char *pipelined = _pipelined;
+  size_t pipelinedLen = _pipelinedLen;
+  _pipelined = NULL;
+  if(_onDisconnectfn) {
+      _onDisconnectfn();
+    }
+  _server->_handleDisconnect(this);
+  if(pipelined != NULL){
+    r->_onPipelined(pipelined, pipelinedLen);
+    free(pipelined);
+  }
 }
 
 void AsyncWebServerRequest::_onData(void *buf, size_t len){
   size_t i = 0;
   while (true) {
 
-  if(_parseState < PARSE_REQ_BODY){
-    // Find new line in buf
+  if(_parseState == PARSE_REQ_END){
+    // the next request is already here, it is parsed once this one is answered
+    if(!_stashPipelined((const char*)buf, len)){
+      _client->close();
+    }
+  } else if(_parseState < PARSE_REQ_BODY){
+    // Copy up to the next new line into the header buffer, the line is parsed in place once complete
     char *str = (char*)buf;
-    for (i = 0; i < len; i++) {
-      if (str[i] == '\n') {
-        break;
-      }
+    char *nl = (char*)memchr(str, '\n', len);
+    i = nl ? (size_t)(nl - str) : len;
+    if(_server->maxHeaderSize() && _rawHeadersLen + i > _server->maxHeaderSize()){
+      _reject(431);
+      break;
     }
-    if (i == len) { // No new line, just add the buffer in _temp
-      char ch = str[len-1];
-      str[len-1] = 0;
-      _temp.reserve(_temp.length()+len);
-      _temp.concat(str);
-      _temp.concat(ch);
-    } else { // Found new line - extract it and parse
-      str[i] = 0; // Terminate the string at the end of the line.
-      _temp.concat(str);
-      _temp.trim();
+    if(!_appendRawHeaders(str, i)){
+      _parseState = PARSE_REQ_FAIL;
+      _client->close();
+      break;
+    }
+    if (nl) {
       _parseLine();
       if (++i < len) {
         // Still have more buffer to process
@@ -132,14 +284,16 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
     // A handler should be already attached at this point in _parseLine function.
     // If handler does nothing (_onRequest is NULL), we don't need to really parse the body.
     const bool needParse = _handler && !_handler->isRequestHandlerTrivial();
+    // anything past the body belongs to the next request
+    size_t rest = 0;
+    if(len > _contentLength - _parsedLength){
+      rest = len - (_contentLength - _parsedLength);
+      len -= rest;
+    }
     if(_isMultipart){
-      if(needParse){
-        size_t i;
-        for(i=0; i<len; i++){
-          _parseMultipartPostByte(((uint8_t*)buf)[i], i == len - 1);
-          _parsedLength++;
-        }
-      } else
+      if(needParse)
+          _parseMultipartPost((uint8_t*)buf, len);
+      else
           _parsedLength += len;
     } else {
       if(_parsedLength == 0){
@@ -158,39 +312,173 @@ void AsyncWebServerRequest::_onData(void *buf, size_t len){
         if(_handler) _handler->handleBody(this, (uint8_t*)buf, len, _parsedLength, _contentLength);
         _parsedLength += len;
       } else if(needParse) {
-        size_t i;
-        for(i=0; i<len; i++){
-          _parsedLength++;
-          _parsePlainPostChar(((uint8_t*)buf)[i]);
+        if(!_parsePlainPost((uint8_t*)buf, len)){
+          _reject(413);
+          break;
         }
+        _parsedLength += len;
       } else {
         _parsedLength += len;
       }
     }
+    if(_rejectCode){
+      _reject(_rejectCode);
+      break;
+    }
     if(_parsedLength == _contentLength){
       _parseState = PARSE_REQ_END;
       //check if authenticated before calling handleRequest and request auth instead
       if(_handler) _handler->handleRequest(this);
       else send(501);
     }
+    if(rest && !_pendingDisconnect){
+      buf = (char*)buf + len;
+      len = rest;
+      continue;
+    }
   }
   break;
   }
 }
 
+bool AsyncWebServerRequest::_appendRawHeaders(const char *data, size_t len){
+  // keep a spare byte so the current line can always be NUL terminated
+  if(_rawHeadersLen + len + 1 > _rawHeadersSize){
+    size_t size = _rawHeadersSize ? _rawHeadersSize : 256;
+    while(size < _rawHeadersLen + len + 1){
+      size *= 2;
+    }
+    // the old copy stays behind in the arena, headers rarely outgrow the first one
+    char *grown = (char*)_arena.alloc(size);
+    if(grown == NULL){
+      return false;
+    }
+    if(_rawHeadersLen){
+      memcpy(grown, _rawHeaders, _rawHeadersLen);
+    }
+    _rawHeaders = grown;
+    _rawHeadersSize = size;
+  }
+  memcpy(_rawHeaders + _rawHeadersLen, data, len);
+  _rawHeadersLen += len;
+  return true;
+}
+
+void AsyncWebServerRequest::_resetHeaderIndex(){
+  memset(_headerBuckets, 0xFF, sizeof(_headerBuckets));
+  memset(_knownHeaders, 0xFF, sizeof(_knownHeaders));
+}
+
+bool AsyncWebServerRequest::_indexHeader(size_t num, size_t offset, uint32_t hash, WebRequestHeader id){
+  if(num >= ASYNC_WEB_HEADER_NONE){
+    return false;
+  }
+  if(num >= _headerSlotsSize){
+    size_t size = _headerSlotsSize ? _headerSlotsSize * 2 : 16;
+    HeaderSlot *grown = (HeaderSlot*)_arena.alloc(size * sizeof(HeaderSlot));
+    if(grown == NULL){
+      return false;
+    }
+    if(_headerSlotsSize){
+      memcpy(grown, _headerSlots, _headerSlotsSize * sizeof(HeaderSlot));
+    }
+    _headerSlots = grown;
+    _headerSlotsSize = size;
+  }
+  HeaderSlot &slot = _headerSlots[num];
+  slot.hash = hash;
+  slot.offset = offset;
+  slot.next = ASYNC_WEB_HEADER_NONE;
+  slot.keep = false;
+  // append, so lookups find the first occurrence like they always did
+  uint16_t *link = &_headerBuckets[hash & (ASYNC_WEB_HEADER_BUCKETS - 1)];
+  while(*link != ASYNC_WEB_HEADER_NONE){
+    link = &_headerSlots[*link].next;
+  }
+  *link = num;
+  if(id < HEADER_MAX && _knownHeaders[id] == ASYNC_WEB_HEADER_NONE){
+    _knownHeaders[id] = num;
+  }
+  return true;
+}
+
+size_t AsyncWebServerRequest::_findHeader(const char *name) const {
+  uint32_t hash = headerHash(name);
+  for(uint16_t num = _headerBuckets[hash & (ASYNC_WEB_HEADER_BUCKETS - 1)]; num != ASYNC_WEB_HEADER_NONE; num = _headerSlots[num].next){
+    if(_headerSlots[num].hash == hash && !strcasecmp(_rawHeaders + _headerSlots[num].offset, name)){
+      return num;
+    }
+  }
+  return _headerCount;
+}
+
+size_t AsyncWebServerRequest::_findHeader(WebRequestHeader id) const {
+  if(id >= HEADER_MAX || _knownHeaders[id] == ASYNC_WEB_HEADER_NONE){
+    return _headerCount;
+  }
+  return _knownHeaders[id];
+}
+
+AsyncWebHeader* AsyncWebServerRequest::_headerObject(size_t num) const {
+  if(num >= _headerCount){
+    return nullptr;
+  }
+  // handlers only look at headers once all of them have been received
+  if(_headerObjects == NULL){
+    _headerObjects = (AsyncWebHeader**)_arena.alloc(_headerCount * sizeof(AsyncWebHeader*));
+    if(_headerObjects == NULL){
+      return nullptr;
+    }
+    memset(_headerObjects, 0, _headerCount * sizeof(AsyncWebHeader*));
+  }
+  if(_headerObjects[num] == NULL){
+    const char *name = _rawHeaders + _headerSlots[num].offset;
+    _headerObjects[num] = _arena.make<AsyncWebHeader>(String(name), String(name + strlen(name) + 1));
+  }
+  return _headerObjects[num];
+}
+
 void AsyncWebServerRequest::_removeNotInterestingHeaders(){
   if (_interestingHeaders.containsIgnoreCase("ANY")) return; // nothing to do
-  for(const auto& header: _headers){
-      if(!_interestingHeaders.containsIgnoreCase(header->name().c_str())){
-        _headers.remove(header);
+  // mark every occurrence of the interesting names through the hash chains
+  for(const auto& interesting: _interestingHeaders){
+    const char *name = interesting.c_str();
+    uint32_t hash = headerHash(name);
+    for(uint16_t num = _headerBuckets[hash & (ASYNC_WEB_HEADER_BUCKETS - 1)]; num != ASYNC_WEB_HEADER_NONE; num = _headerSlots[num].next){
+      if(_headerSlots[num].hash == hash && !strcasecmp(_rawHeaders + _headerSlots[num].offset, name)){
+        _headerSlots[num].keep = true;
       }
+    }
   }
+  // compact the records that are kept to the front of the buffer and index them again
+  _resetHeaderIndex();
+  size_t out = 0;
+  size_t kept = 0;
+  for(size_t num = 0; num < _headerCount; num++){
+    HeaderSlot slot = _headerSlots[num];
+    if(!slot.keep){
+      continue;
+    }
+    char *name = _rawHeaders + slot.offset;
+    size_t nameLen = strlen(name);
+    size_t recordLen = nameLen + strlen(name + nameLen + 1) + 2;
+    memmove(_rawHeaders + out, name, recordLen);
+    if(_headerObjects){
+      _headerObjects[kept] = _headerObjects[num];
+    }
+    _indexHeader(kept, out, slot.hash, knownHeader(_rawHeaders + out, slot.hash));
+    out += recordLen;
+    kept++;
+  }
+  _rawHeadersLen = out;
+  _lineStart = out;
+  _headerCount = kept;
 }
 
 void AsyncWebServerRequest::_onPoll(){
   //os_printf("p\n");
   if(_response != NULL && _client != NULL && _client->canSend() && !_response->_finished()){
-    _response->_ack(this, 0, 0);
+    _ackResponse(0, 0);
   }
 }
 
@@ -198,7 +486,9 @@ void AsyncWebServerRequest::_onAck(size_t len, uint32_t time){
   //os_printf("a:%u:%u\n", len, time);
   if(_response != NULL){
     if(!_response->_finished()){
-      _response->_ack(this, len, time);
+      _ackResponse(len, time);
+    } else if(_persistent && !_response->_failed()){
+      _next();
     } else {
       AsyncWebServerResponse* r = _response;
       _response = NULL;
@@ -207,6 +497,82 @@ void AsyncWebServerRequest::_onAck(size_t len, uint32_t time){
   }
 }
 
+void AsyncWebServerRequest::_ackResponse(size_t len, uint32_t time){
+  if(!_persistent && _parseState != PARSE_REQ_FAIL){
+    // WebSocket and EventSource responses delete this request from inside _ack
+    _response->_ack(this, len, time);
+    return;
+  }
+  _inCallback = true;
+  _response->_ack(this, len, time);
+  _inCallback = false;
+  if(_pendingDisconnect){
+    _onDisconnect();
+  } else if(_response->_finished()){
+    if(_persistent && !_response->_failed()){
+      _next();
+    } else {
+      // refused requests do not wait for the client to hang up
+      _client->close();
+    }
+  }
+}
+
+bool AsyncWebServerRequest::_applyLimits(){
+  if(_handler){
+    if(_handler->maxBodySize()) _maxBodySize = _handler->maxBodySize();
+    if(_handler->maxParams()) _maxParams = _handler->maxParams();
+    if(_handler->maxHeaderSize() && _rawHeadersLen > _handler->maxHeaderSize()){
+      _reject(431);
+      return false;
+    }
+  }
+  if(_maxParams && _paramCount() > _maxParams){
+    _reject(414);
+    return false;
+  }
+  if(_maxBodySize && _contentLength > _maxBodySize){
+    _reject(413);
+    return false;
+  }
+  return true;
+}
+
+void AsyncWebServerRequest::_reject(int code){
+  // Nothing parsed so far is needed for the answer, give it all back before sending it
+  _parseState = PARSE_REQ_FAIL;
+  _handler = NULL;
+  _interestingHeaders.free();
+  _rawHeaders = NULL;
+  _rawHeadersLen = 0;
+  _rawHeadersSize = 0;
+  _lineStart = 0;
+  _headerCount = 0;
+  _headerObjects = NULL;
+  _headerSlots = NULL;
+  _headerSlotsSize = 0;
+  _resetHeaderIndex();
+  _params = ArenaList<AsyncWebParameter *>();
+  _pathParams = ArenaList<String *>();
+  _formFields = ArenaList<FormField *>();
+  _form = NULL;
+  _multipartDelimiter = NULL;
+  _multipartSkip = NULL;
+  _multipartDelimiterLen = 0;
+  _arena.clear();
+  free(_itemBuffer);
+  _itemBuffer = NULL;
+  _temp = String();
+  _itemValue = String();
+  free(_pipelined);
+  _pipelined = NULL;
+  _pipelinedLen = 0;
+  // a handler may have answered already, the connection then closes once that is out
+  if(_response == NULL){
+    send(code);
+  }
+}
+
 void AsyncWebServerRequest::_onError(int8_t error){
   (void)error;
 }
@@ -223,18 +589,36 @@ void AsyncWebServerRequest::onDisconnect (ArDisconnectHandler fn){
 
 void AsyncWebServerRequest::_onDisconnect(){
   //os_printf("d\n");
+  if(_inCallback){
+    _pendingDisconnect = true;
+    return;
+  }
+  AsyncClient* c = _client;
   if(_onDisconnectfn) {
       _onDisconnectfn();
     }
   _server->_handleDisconnect(this);
+  delete c;
 }
 
 void AsyncWebServerRequest::_addParam(AsyncWebParameter *p){
-  _params.add(p);
+  if(p == NULL){
+    return;
+  }
+  // query parameters are bounded by the header size and checked once the route is known
+  if(_parseState == PARSE_REQ_BODY && _maxParams && _paramCount() >= _maxParams){
+    // dropped, the request is refused once the body parser gets to a safe point
+    _rejectCode = 413;
+    return;
+  }
+  _params.add(_arena, p);
 }
 
 void AsyncWebServerRequest::_addPathParam(const char *p){
-  _pathParams.add(new String(p));
+  String *s = _arena.make<String>(p);
+  if(s != NULL){
+    _pathParams.add(_arena, s);
+  }
 }
 
 void AsyncWebServerRequest::_addGetParams(const String& params){
@@ -246,48 +630,55 @@ void AsyncWebServerRequest::_addGetParams(const String& params){
     if (equal < 0 || equal > end) equal = end;
     String name = params.substring(start, equal);
     String value = equal + 1 < end ? params.substring(equal + 1, end) : String();
-    _addParam(new AsyncWebParameter(urlDecode(name), urlDecode(value)));
+    _addParam(_arena.make<AsyncWebParameter>(urlDecode(name), urlDecode(value)));
     start = end + 1;
   }
 }
 
-bool AsyncWebServerRequest::_parseReqHead(){
+bool AsyncWebServerRequest::_parseReqHead(char *line, size_t len){
   // Split the head into method, url and version
-  int index = _temp.indexOf(' ');
-  String m = _temp.substring(0, index);
-  index = _temp.indexOf(' ', index+1);
-  String u = _temp.substring(m.length()+1, index);
-  _temp = _temp.substring(index+1);
+  char *end = line + len;
+  *end = 0;
+  char *m = line;
+  char *u = (char*)memchr(m, ' ', len);
+  u = u ? u + 1 : end;
+  char *v = (char*)memchr(u, ' ', end - u);
+  v = v ? v + 1 : end;
+  size_t mLen = (u > m && u[-1] == ' ') ? (size_t)(u - m - 1) : (size_t)(u - m);
+  if(v > u && v[-1] == ' '){
+    v[-1] = 0;
+  }
 
-  if(m == "GET"){
+  if(mLen == 3 && !strncmp(m, "GET", 3)){
     _method = HTTP_GET;
-  } else if(m == "POST"){
+  } else if(mLen == 4 && !strncmp(m, "POST", 4)){
     _method = HTTP_POST;
-  } else if(m == "DELETE"){
+  } else if(mLen == 6 && !strncmp(m, "DELETE", 6)){
     _method = HTTP_DELETE;
-  } else if(m == "PUT"){
+  } else if(mLen == 3 && !strncmp(m, "PUT", 3)){
     _method = HTTP_PUT;
-  } else if(m == "PATCH"){
+  } else if(mLen == 5 && !strncmp(m, "PATCH", 5)){
     _method = HTTP_PATCH;
-  } else if(m == "HEAD"){
+  } else if(mLen == 4 && !strncmp(m, "HEAD", 4)){
     _method = HTTP_HEAD;
-  } else if(m == "OPTIONS"){
+  } else if(mLen == 7 && !strncmp(m, "OPTIONS", 7)){
     _method = HTTP_OPTIONS;
   }
 
-  String g = String();
-  index = u.indexOf('?');
-  if(index > 0){
-    g = u.substring(index +1);
-    u = u.substring(0, index);
+  char *g = strchr(u, '?');
+  if(g != NULL && g > u){
+    *g++ = 0;
+  } else {
+    g = NULL;
   }
-  _url = urlDecode(u);
-  _addGetParams(g);
+  _url = urlDecode(String(u));
+  _addGetParams(g ? String(g) : String());
 
-  if(!_temp.startsWith("HTTP/1.0"))
+  if(strncmp(v, "HTTP/1.0", 8))
     _version = 1;
+  // HTTP/1.1 connections persist unless the client says otherwise
+  _keepAlive = _version == 1;
 
-  _temp = String();
   return true;
 }
 
@@ -309,61 +700,178 @@ bool strContains(String src, String find, bool mindcase = true) {
   return false;
 }
 
-bool AsyncWebServerRequest::_parseReqHeader(){
-  int index = _temp.indexOf(':');
-  if(index){
-    String name = _temp.substring(0, index);
-    String value = _temp.substring(index + 2);
-    if(name.equalsIgnoreCase("Host")){
-      _host = value;
-    } else if(name.equalsIgnoreCase("Content-Type")){
-	  _contentType = value.substring(0, value.indexOf(';'));
-      if (value.startsWith("multipart/")){
-        _boundary = value.substring(value.indexOf('=')+1);
-        _boundary.replace("\"","");
-        _isMultipart = true;
-      }
-    } else if(name.equalsIgnoreCase("Content-Length")){
-      _contentLength = atoi(value.c_str());
-    } else if(name.equalsIgnoreCase("Expect") && value == "100-continue"){
+bool AsyncWebServerRequest::_parseReqHeader(char *line, size_t len){
+  char *colon = (char*)memchr(line, ':', len);
+  if(colon == NULL || colon == line){
+    _rawHeadersLen = _lineStart;
+    return false;
+  }
+  char *value = colon + 1;
+  char *end = line + len;
+  while(value < end && (*value == ' ' || *value == '\t')){
+    value++;
+  }
+  // Rewrite the line in place as a "name\0value\0" record
+  size_t nameLen = colon - line;
+  size_t valueLen = end - value;
+  char *name = _rawHeaders + _lineStart;
+  memmove(name, line, nameLen);
+  name[nameLen] = 0;
+  memmove(name + nameLen + 1, value, valueLen);
+  value = name + nameLen + 1;
+  value[valueLen] = 0;
+  _rawHeadersLen = _lineStart + nameLen + valueLen + 2;
+
+  uint32_t hash = headerHash(name);
+  WebRequestHeader id = knownHeader(name, hash);
+  if(!_indexHeader(_headerCount, _lineStart, hash, id)){
+    _rawHeadersLen = _lineStart;
+    return false;
+  }
+  _headerCount++;
+
+  switch(id){
+  case HEADER_HOST:
+    _host = value;
+    break;
+  case HEADER_CONTENT_TYPE: {
+    const char *semicolon = strchr(value, ';');
+    _contentType = semicolon ? String(value).substring(0, semicolon - value) : String(value);
+    if (!strncmp(value, "multipart/", 10)){
+      const char *equal = strchr(value, '=');
+      _boundary = equal ? equal + 1 : value + valueLen;
+      _boundary.replace("\"","");
+      _isMultipart = true;
+    }
+    break;
+  }
+  case HEADER_CONTENT_LENGTH:
+    _contentLength = atoi(value);
+    break;
+  case HEADER_EXPECT:
+    if(!strcmp(value, "100-continue")){
       _expectingContinue = true;
-    } else if(name.equalsIgnoreCase("Authorization")){
-      if(value.length() > 5 && value.substring(0,5).equalsIgnoreCase("Basic")){
-        _authorization = value.substring(6);
-      } else if(value.length() > 6 && value.substring(0,6).equalsIgnoreCase("Digest")){
-        _isDigest = true;
-        _authorization = value.substring(7);
-      }
-    } else {
-      if(name.equalsIgnoreCase("Upgrade") && value.equalsIgnoreCase("websocket")){
-        // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
-        _reqconntype = RCT_WS;
-      } else {
-        if(name.equalsIgnoreCase("Accept") && strContains(value, "text/event-stream", false)){
-          // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
-          _reqconntype = RCT_EVENT;
-        }
-      }
     }
-    _headers.add(new AsyncWebHeader(name, value));
+    break;
+  case HEADER_AUTHORIZATION:
+    if(valueLen > 5 && !strncasecmp(value, "Basic", 5)){
+      _authorization = value + 6;
+    } else if(valueLen > 6 && !strncasecmp(value, "Digest", 6)){
+      _isDigest = true;
+      _authorization = value + 7;
+    }
+    break;
+  case HEADER_CONNECTION:
+    if(strContains(String(value), "close", false)){
+      _keepAlive = false;
+    } else if(strContains(String(value), "keep-alive", false)){
+      _keepAlive = true;
+    }
+    break;
+  case HEADER_UPGRADE:
+    if(!strcasecmp(value, "websocket")){
+      // WebSocket request can be uniquely identified by header: [Upgrade: websocket]
+      _reqconntype = RCT_WS;
+    }
+    break;
+  case HEADER_ACCEPT:
+    if(strContains(String(value), "text/event-stream", false)){
+      // WebEvent request can be uniquely identified by header:  [Accept: text/event-stream]
+      _reqconntype = RCT_EVENT;
+    }
+    break;
+  default:
+    break;
   }
-  _temp = String();
   return true;
 }
 
-void AsyncWebServerRequest::_parsePlainPostChar(uint8_t data){
-  if(data && (char)data != '&')
-    _temp += (char)data;
-  if(!data || (char)data == '&' || _parsedLength == _contentLength){
-    String name = "body";
-    String value = _temp;
-    if(!_temp.startsWith("{") && !_temp.startsWith("[") && _temp.indexOf('=') > 0){
-      name = _temp.substring(0, _temp.indexOf('='));
-      value = _temp.substring(_temp.indexOf('=') + 1);
+static int hexValue(char c){
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// decodes %XX and '+' over the string itself, the result is never longer
+static void urlDecodeInPlace(char *text){
+  char *out = text;
+  for(const char *in = text; *in; in++){
+    int hi, lo;
+    if(*in == '%' && (hi = hexValue(in[1])) >= 0 && (lo = hexValue(in[2])) >= 0){
+      *out++ = (char)((hi << 4) | lo);
+      in += 2;
+    } else if(*in == '+'){
+      *out++ = ' ';
+    } else {
+      *out++ = *in;
     }
-    _addParam(new AsyncWebParameter(urlDecode(name), urlDecode(value), true));
-    _temp = String();
   }
+  *out = 0;
+}
+
+bool AsyncWebServerRequest::_parsePlainPost(const uint8_t *data, size_t len){
+  if(_form == NULL){
+    // the whole body is bounded before a single byte of it is stored
+    if(_contentLength > _server->maxFormSize()){
+      return false;
+    }
+    _form = (char*)_arena.alloc(_contentLength + 1);
+    if(_form == NULL){
+      return false;
+    }
+  }
+  if(len > _contentLength - _formLen){
+    len = _contentLength - _formLen;
+  }
+  memcpy(_form + _formLen, data, len);
+  _formLen += len;
+
+  // fields may be split across segments, only the complete ones are decoded
+  char *amp;
+  while((amp = (char*)memchr(_form + _formStart, '&', _formLen - _formStart)) != NULL){
+    _addFormField(_form + _formStart, amp - (_form + _formStart));
+    _formStart = amp - _form + 1;
+  }
+  if(_formLen == _contentLength && _formStart < _formLen){
+    _addFormField(_form + _formStart, _formLen - _formStart);
+    _formStart = _formLen;
+  }
+  return true;
+}
+
+void AsyncWebServerRequest::_addFormField(char *field, size_t len){
+  if(_maxParams && _paramCount() >= _maxParams){
+    // dropped, the request is refused once the body parser gets to a safe point
+    _rejectCode = 413;
+    return;
+  }
+  // the '&' or the spare byte at the end of the buffer becomes the terminator
+  field[len] = 0;
+  const char *name = "body";
+  char *value = field;
+  char *equal = (char*)memchr(field, '=', len);
+  if(*field != '{' && *field != '[' && equal != NULL && equal > field){
+    *equal = 0;
+    urlDecodeInPlace(field);
+    name = field;
+    value = equal + 1;
+  }
+  urlDecodeInPlace(value);
+  FormField *f = _arena.make<FormField>();
+  if(f != NULL){
+    f->name = name;
+    f->value = value;
+    f->param = NULL;
+    _formFields.add(_arena, f);
+  }
+}
+
+AsyncWebParameter* AsyncWebServerRequest::_formParam(FormField *f) const {
+  if(f->param == NULL){
+    f->param = _arena.make<AsyncWebParameter>(String(f->name), String(f->value), true);
+  }
+  return f->param;
 }
 
 void AsyncWebServerRequest::_handleUploadByte(uint8_t data, bool last){
@@ -391,8 +899,89 @@ enum {
   PARSE_ERROR
 };
 
+bool AsyncWebServerRequest::_prepareMultipartDelimiter(){
+  // part data ends at "\r\n--" followed by the boundary
+  size_t len = _boundary.length() + 4;
+  if(len > 255){
+    return false;
+  }
+  _multipartDelimiter = (uint8_t*)_arena.alloc(len + 256);
+  if(_multipartDelimiter == NULL){
+    return false;
+  }
+  _multipartSkip = _multipartDelimiter + len;
+  _multipartDelimiterLen = len;
+  memcpy(_multipartDelimiter, "\r\n--", 4);
+  memcpy(_multipartDelimiter + 4, _boundary.c_str(), _boundary.length());
+  memset(_multipartSkip, len, 256);
+  for(size_t i = 0; i < len - 1; i++){
+    _multipartSkip[_multipartDelimiter[i]] = len - 1 - i;
+  }
+  return true;
+}
+
+size_t AsyncWebServerRequest::_multipartDataRun(const uint8_t *data, size_t len) const {
+  // Horspool search for the delimiter. Every alignment before the returned
+  // offset has been ruled out, so those bytes are part data for certain.
+  const size_t last = _multipartDelimiterLen - 1;
+  size_t pos = 0;
+  while(pos + last < len){
+    uint8_t c = data[pos + last];
+    if(c == _multipartDelimiter[last] && !memcmp(data + pos, _multipartDelimiter, last)){
+      return pos;
+    }
+    pos += _multipartSkip[c];
+  }
+  return pos;
+}
+
+void AsyncWebServerRequest::_itemWriteRun(uint8_t *data, size_t len){
+  _itemSize += len;
+  if(!_itemIsFile){
+    // field values are held in memory, they get the same bound as url encoded bodies
+    if(_itemValue.length() + len > _server->maxFormSize()){
+      _rejectCode = 413;
+      return;
+    }
+    _itemValue.concat((const char*)data, len);
+    return;
+  }
+  //check if authenticated before calling the upload
+  if(_handler){
+    // bytes left over from the byte parser go first
+    if(_itemBufferIndex){
+      _handler->handleUpload(this, _itemFilename, _itemSize - len - _itemBufferIndex, _itemBuffer, _itemBufferIndex, false);
+    }
+    _handler->handleUpload(this, _itemFilename, _itemSize - len, data, len, false);
+  }
+  _itemBufferIndex = 0;
+}
+
+void AsyncWebServerRequest::_parseMultipartPost(uint8_t *data, size_t len){
+  if(!_parsedLength && !_prepareMultipartDelimiter()){
+    _multipartDelimiterLen = 0;
+  }
+  size_t i = 0;
+  while(i < len){
+    // inside part data hand everything up to a possible delimiter over in one go,
+    // the byte parser below deals with the delimiter and the part headers
+    if(_multiParseState == WAIT_FOR_RETURN1 && _multipartDelimiterLen){
+      size_t run = _multipartDataRun(data + i, len - i);
+      if(run){
+        _itemWriteRun(data + i, run);
+        _parsedLength += run;
+        i += run;
+        continue;
+      }
+    }
+    _parseMultipartPostByte(data[i], i == len - 1);
+    _parsedLength++;
+    i++;
+  }
+}
+
 void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last){
-#define itemWriteByte(b) do { _itemSize++; if(_itemIsFile) _handleUploadByte(b, last); else _itemValue+=(char)(b); } while(0)
+#define itemWriteByte(b) do { _itemSize++; if(_itemIsFile) _handleUploadByte(b, last); else if(_itemValue.length() < _server->maxFormSize()) _itemValue+=(char)(b); else _rejectCode = 413; } while(0)
 
   if(!_parsedLength){
     _multiParseState = EXPECT_BOUNDARY;
@@ -508,13 +1097,13 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last){
     } else if(_boundaryPosition == _boundary.length() - 1){
       _multiParseState = DASH3_OR_RETURN2;
       if(!_itemIsFile){
-        _addParam(new AsyncWebParameter(_itemName, _itemValue, true));
+        _addParam(_arena.make<AsyncWebParameter>(_itemName, _itemValue, true));
       } else {
         if(_itemSize){
           //check if authenticated before calling the upload
           if(_handler) _handler->handleUpload(this, _itemFilename, _itemSize - _itemBufferIndex, _itemBuffer, _itemBufferIndex, true);
           _itemBufferIndex = 0;
-          _addParam(new AsyncWebParameter(_itemName, _itemFilename, true, true, _itemSize));
+          _addParam(_arena.make<AsyncWebParameter>(_itemName, _itemFilename, true, true, _itemSize));
         }
         free(_itemBuffer);
         _itemBuffer = NULL;
@@ -552,22 +1141,39 @@ void AsyncWebServerRequest::_parseMultipartPostByte(uint8_t data, bool last){
 }
 
 void AsyncWebServerRequest::_parseLine(){
+  // Trim the line, it runs from _lineStart to the end of the header buffer
+  char *line = _rawHeaders + _lineStart;
+  size_t len = _rawHeadersLen - _lineStart;
+  while(len && isspace((unsigned char)line[len - 1])){
+    len--;
+  }
+  while(len && isspace((unsigned char)*line)){
+    line++;
+    len--;
+  }
+
   if(_parseState == PARSE_REQ_START){
-    if(!_temp.length()){
+    if(!len){
       _parseState = PARSE_REQ_FAIL;
       _client->close();
     } else {
-      _parseReqHead();
+      _parseReqHead(line, len);
       _parseState = PARSE_REQ_HEADERS;
     }
+    // the request line is not kept
+    _rawHeadersLen = _lineStart;
     return;
   }
 
   if(_parseState == PARSE_REQ_HEADERS){
-    if(!_temp.length()){
+    if(!len){
+      _rawHeadersLen = _lineStart;
       //end of headers
       _server->_rewriteRequest(this);
       _server->_attachHandler(this);
+      if(!_applyLimits()){
+        return;
+      }
       _removeNotInterestingHeaders();
       if(_expectingContinue){
         const char * response = "HTTP/1.1 100 Continue\r\n\r\n";
@@ -581,21 +1187,19 @@ void AsyncWebServerRequest::_parseLine(){
         if(_handler) _handler->handleRequest(this);
         else send(501);
       }
-    } else _parseReqHeader();
+    } else {
+      _parseReqHeader(line, len);
+      _lineStart = _rawHeadersLen;
+    }
   }
 }
 
 size_t AsyncWebServerRequest::headers() const{
-  return _headers.length();
+  return _headerCount;
 }
 
 bool AsyncWebServerRequest::hasHeader(const String& name) const {
-  for(const auto& h: _headers){
-    if(h->name().equalsIgnoreCase(name)){
-      return true;
-    }
-  }
-  return false;
+  return _findHeader(name.c_str()) < _headerCount;
 }
 
 bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper * data) const {
@@ -619,12 +1223,7 @@ bool AsyncWebServerRequest::hasHeader(const __FlashStringHelper * data) const {
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const {
-  for(const auto& h: _headers){
-    if(h->name().equalsIgnoreCase(name)){
-      return h;
-    }
-  }
-  return nullptr;
+  return _headerObject(_findHeader(name.c_str()));
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(const __FlashStringHelper * data) const {
@@ -642,12 +1241,19 @@ AsyncWebHeader* AsyncWebServerRequest::getHeader(const __FlashStringHelper * dat
 }
 
 AsyncWebHeader* AsyncWebServerRequest::getHeader(size_t num) const {
-  auto header = _headers.nth(num);
-  return header ? *header : nullptr;
+  return _headerObject(num);
+}
+
+bool AsyncWebServerRequest::hasHeader(WebRequestHeader id) const {
+  return _findHeader(id) < _headerCount;
+}
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(WebRequestHeader id) const {
+  return _headerObject(_findHeader(id));
 }
 
 size_t AsyncWebServerRequest::params() const {
-  return _params.length();
+  return _paramCount();
 }
 
 bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) const {
@@ -656,7 +1262,7 @@ bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) c
       return true;
     }
   }
-  return false;
+  return post && !file && formArg(name.c_str()) != NULL;
 }
 
 bool AsyncWebServerRequest::hasParam(const __FlashStringHelper * data, bool post, bool file) const {
@@ -681,6 +1287,13 @@ AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post
       return p;
     }
   }
+  if(post && !file){
+    for(const auto& f: _formFields){
+      if(name == f->name){
+        return _formParam(f);
+      }
+    }
+  }
   return nullptr;
 }
 
@@ -699,8 +1312,11 @@ AsyncWebParameter* AsyncWebServerRequest::getParam(const __FlashStringHelper * d
 }
 
 AsyncWebParameter* AsyncWebServerRequest::getParam(size_t num) const {
-  auto param = _params.nth(num);
-  return param ? *param : nullptr;
+  if(num >= _params.length()){
+    auto f = _formFields.nth(num - _params.length());
+    return f ? _formParam(*f) : nullptr;
+  }
+  return *_params.nth(num);
 }
 
 void AsyncWebServerRequest::addInterestingHeader(const String& name){
@@ -711,8 +1327,8 @@ void AsyncWebServerRequest::addInterestingHeader(const String& name){
 void AsyncWebServerRequest::send(AsyncWebServerResponse *response){
   _response = response;
   if(_response == NULL){
+    // closing calls back into _onDisconnect
     _client->close(true);
-    _onDisconnect();
     return;
   }
   if(!_response->_sourceValid()){
@@ -722,6 +1338,8 @@ void AsyncWebServerRequest::send(AsyncWebServerResponse *response){
   }
   else {
     _client->setRxTimeout(0);
+    // polls are only needed to push the response out, a request still being received does not get them
+    _client->onPoll([](void *r, AsyncClient* c){ (void)c; AsyncWebServerRequest *req = ( AsyncWebServerRequest*)r; req->_onPoll(); }, this);
     _response->_respond(this);
   }
 }
@@ -867,7 +1485,7 @@ bool AsyncWebServerRequest::hasArg(const char* name) const {
       return true;
     }
   }
-  return false;
+  return formArg(name) != NULL;
 }
 
 bool AsyncWebServerRequest::hasArg(const __FlashStringHelper * data) const {
@@ -891,6 +1509,12 @@ const String& AsyncWebServerRequest::arg(const String& name) const {
       return arg->value();
     }
   }
+  for(const auto& f: _formFields){
+    if(name == f->name){
+      AsyncWebParameter *p = _formParam(f);
+      return p ? p->value() : SharedEmptyString;
+    }
+  }
   return SharedEmptyString;
 }
 
@@ -917,13 +1541,27 @@ const String& AsyncWebServerRequest::argName(size_t i) const {
   return getParam(i)->name();
 }
 
+const char * AsyncWebServerRequest::formArg(const char* name) const {
+  for(const auto& f: _formFields){
+    if(!strcmp(f->name, name)){
+      return f->value;
+    }
+  }
+  return NULL;
+}
+
 const String& AsyncWebServerRequest::pathArg(size_t i) const {
   auto param = _pathParams.nth(i);
   return param ? **param : SharedEmptyString;
 }
 
 const String& AsyncWebServerRequest::header(const char* name) const {
-  AsyncWebHeader* h = getHeader(String(name));
+  AsyncWebHeader* h = _headerObject(_findHeader(name));
+  return h ? h->value() : SharedEmptyString;
+}
+
+const String& AsyncWebServerRequest::header(WebRequestHeader id) const {
+  AsyncWebHeader* h = _headerObject(_findHeader(id));
   return h ? h->value() : SharedEmptyString;
 }
 
@@ -31,6 +31,7 @@
 
 class AsyncBasicResponse: public AsyncWebServerResponse {
   private:
+    String _head;
     String _content;
   public:
     AsyncBasicResponse(int code, const String& contentType=String(), const String& content=String());
@@ -39,31 +40,57 @@ class AsyncBasicResponse: public AsyncWebServerResponse {
     bool _sourceValid() const { return true; }
 };
 
+#ifndef TEMPLATE_PLACEHOLDER
+#define TEMPLATE_PLACEHOLDER '%'
+#endif
+
+#ifndef TEMPLATE_LOOKAHEAD
+#define TEMPLATE_LOOKAHEAD 256 //bytes read from the source at a time while expanding templates
+#endif
+
+#define TEMPLATE_PARAM_NAME_LENGTH 32
+
 class AsyncAbstractResponse: public AsyncWebServerResponse {
   private:
     String _head;
-    // Data is inserted into cache at begin(). 
-    // This is inefficient with vector, but if we use some other container, 
-    // we won't be able to access it as contiguous array of bytes when reading from it,
-    // so by gaining performance in one place, we'll lose it in another.
-    std::vector<uint8_t> _cache;
-    size_t _readDataFromCacheOrContent(uint8_t* data, const size_t len);
+    // Templates are expanded as a stream: source bytes wait in the lookahead,
+    // a placeholder name collects in _name across reads and its value drains from _value
+    uint8_t* _lookahead;
+    size_t _lookStart;
+    size_t _lookEnd;
+    char _name[TEMPLATE_PARAM_NAME_LENGTH + 1];
+    size_t _nameLen;
+    bool _inName;
+    String _value;
+    size_t _valueSent;
+    // With a compiled template the source is walked segment by segment instead
+    size_t _segment;
+    size_t _segmentRead;
+    // Send buffers come from the server's pool and stay with lwIP until acked
+    AsyncWebBufferPool* _pool;
+    const char* _tail; // the part of a pooled or mapped buffer the client did not take yet
+    size_t _tailLen;
+    AcBufferReleaseHandler _tailRelease;
+    void* _tailArg;
+    size_t _readLookahead();
     size_t _fillBufferAndProcessTemplates(uint8_t* buf, size_t maxLen);
+    size_t _fillBufferFromTemplate(uint8_t* buf, size_t maxLen);
+    size_t _writeContent(AsyncWebServerRequest *request, size_t space);
+    size_t _writeTail(AsyncClient* client);
   protected:
     AwsTemplateProcessor _callback;
+    AsyncWebTemplate* _template;
   public:
     AsyncAbstractResponse(AwsTemplateProcessor callback=nullptr);
+    ~AsyncAbstractResponse();
     void _respond(AsyncWebServerRequest *request);
     size_t _ack(AsyncWebServerRequest *request, size_t len, uint32_t time);
     bool _sourceValid() const { return false; }
     virtual size_t _fillBuffer(uint8_t *buf __attribute__((unused)), size_t maxLen __attribute__((unused))) { return 0; }
+    // content that stays in place until release is called (if set), queued by reference
+    virtual size_t _mapBuffer(const uint8_t **buf __attribute__((unused)), size_t maxLen __attribute__((unused)), AcBufferReleaseHandler *release __attribute__((unused)), void **arg __attribute__((unused))) { return 0; }
 };
 
-#ifndef TEMPLATE_PLACEHOLDER
-#define TEMPLATE_PLACEHOLDER '%'
-#endif
-
-#define TEMPLATE_PARAM_NAME_LENGTH 32
 class AsyncFileResponse: public AsyncAbstractResponse {
   using File = fs::File;
   using FS = fs::FS;
@@ -75,6 +102,7 @@ class AsyncFileResponse: public AsyncAbstractResponse {
     AsyncFileResponse(FS &fs, const String& path, const String& contentType=String(), bool download=false, AwsTemplateProcessor callback=nullptr);
     AsyncFileResponse(File content, const String& path, const String& contentType=String(), bool download=false, AwsTemplateProcessor callback=nullptr);
     ~AsyncFileResponse();
+    void _respond(AsyncWebServerRequest *request);
     bool _sourceValid() const { return !!(_content); }
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
 };
@@ -112,10 +140,24 @@ class AsyncProgmemResponse: public AsyncAbstractResponse {
   private:
     const uint8_t * _content;
     size_t _readLength;
+    bool _mapped;
   public:
     AsyncProgmemResponse(int code, const String& contentType, const uint8_t * content, size_t len, AwsTemplateProcessor callback=nullptr);
     bool _sourceValid() const { return true; }
     virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+    virtual size_t _mapBuffer(const uint8_t **buf, size_t maxLen, AcBufferReleaseHandler *release, void **arg) override;
+};
+
+class AsyncAssetResponse: public AsyncAbstractResponse {
+  private:
+    AsyncWebAsset* _asset;
+    size_t _readLength;
+  public:
+    AsyncAssetResponse(AsyncWebAsset* asset); //takes over the caller's reference
+    ~AsyncAssetResponse();
+    bool _sourceValid() const { return true; }
+    virtual size_t _fillBuffer(uint8_t *buf, size_t maxLen) override;
+    virtual size_t _mapBuffer(const uint8_t **buf, size_t maxLen, AcBufferReleaseHandler *release, void **arg) override;
 };
 
 class cbuf;
@@ -20,8 +20,19 @@
 */
 #include "ESPAsyncWebServer.h"
 #include "WebResponseImpl.h"
+#include "WebTemplate.h"
+#include "WebAssetCache.h"
 #include "cbuf.h"
+#include "soc/soc.h"
 
+// Constants live in flash mapped into the data bus, they can go to lwIP as they are
+#if defined(SOC_DROM_LOW) && defined(SOC_DROM_HIGH)
+#define ASYNC_WEB_IN_FLASH(p) ((intptr_t)(p) >= SOC_DROM_LOW && (intptr_t)(p) < SOC_DROM_HIGH)
+#else
+#define ASYNC_WEB_IN_FLASH(p) false
+#endif
+
+#ifdef ESP8266
 // Since ESP8266 does not link memchr by default, here's its implementation.
 void* memchr(void* ptr, int ch, size_t count)
 {
@@ -31,6 +42,7 @@ void* memchr(void* ptr, int ch, size_t count)
       return --p;
   return nullptr;
 }
+#endif
 
 
 /*
@@ -72,6 +84,7 @@ const char* AsyncWebServerResponse::_responseCodeToString(int code) {
     case 415: return "Unsupported Media Type";
     case 416: return "Requested range not satisfiable";
     case 417: return "Expectation Failed";
+    case 431: return "Request Header Fields Too Large";
     case 500: return "Internal Server Error";
     case 501: return "Not Implemented";
     case 502: return "Bad Gateway";
@@ -175,10 +188,10 @@ AsyncBasicResponse::AsyncBasicResponse(int code, const String& contentType, cons
     if(!_contentType.length())
       _contentType = "text/plain";
   }
-  addHeader("Connection","close");
 }
 
 void AsyncBasicResponse::_respond(AsyncWebServerRequest *request){
+  addHeader("Connection", request->_persist(true) ? "keep-alive" : "close");
   _state = RESPONSE_HEADERS;
   String out = _assembleHead(request->version());
   size_t outLen = out.length();
@@ -187,9 +200,13 @@ void AsyncBasicResponse::_respond(AsyncWebServerRequest *request){
     _writtenLength += request->client()->write(out.c_str(), outLen);
     _state = RESPONSE_WAIT_ACK;
   } else if(_contentLength && space >= outLen + _contentLength){
-    out += _content;
-    outLen += _contentLength;
-    _writtenLength += request->client()->write(out.c_str(), outLen);
+    // both stay alive until acked, so lwIP can reference them instead of a joined copy
+    _head = out;
+    async_iovec_t iov[2] = {
+      { _head.c_str(), outLen, NULL, NULL },
+      { _content.c_str(), _contentLength, NULL, NULL }
+    };
+    _writtenLength += request->client()->writev(iov, 2);
     _state = RESPONSE_WAIT_ACK;
   } else if(space && space < outLen){
     String partial = out.substring(0, space);
@@ -244,7 +261,7 @@ size_t AsyncBasicResponse::_ack(AsyncWebServerRequest *request, size_t len, uint
  * Abstract Response
  * */
 
-AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _callback(callback)
+AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _lookahead(NULL), _lookStart(0), _lookEnd(0), _nameLen(0), _inName(false), _valueSent(0), _segment(0), _segmentRead(0), _pool(NULL), _tail(NULL), _tailLen(0), _tailRelease(NULL), _tailArg(NULL), _callback(callback), _template(NULL)
 {
   // In case of template processing, we're unable to determine real response size
   if(callback) {
@@ -254,8 +271,21 @@ AsyncAbstractResponse::AsyncAbstractResponse(AwsTemplateProcessor callback): _ca
   }
 }
 
+AsyncAbstractResponse::~AsyncAbstractResponse(){
+  // the client never released this buffer. A part lwIP took already holds a pending slot,
+  // so the connection was aborted rather than closed and nothing points into it any more
+  if(_tailLen && _tailRelease)
+    _tailRelease(_tailArg, _tail, _tailLen);
+  if(_lookahead)
+    free(_lookahead);
+  if(_template)
+    _template->release();
+}
+
 void AsyncAbstractResponse::_respond(AsyncWebServerRequest *request){
-  addHeader("Connection","close");
+  // without a length or chunks the end of the body is the end of the connection
+  bool framed = _sendContentLength || (_chunked && request->version());
+  addHeader("Connection", request->_persist(framed) ? "keep-alive" : "close");
   _head = _assembleHead(request->version());
   _state = RESPONSE_HEADERS;
   _ack(request, 0, 0);
@@ -269,6 +299,11 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
     return 0;
   }
   _ackedLength += len;
+  if(_tailLen){
+    size_t written = _writeTail(request->client());
+    if(_tailLen)
+      return written;
+  }
   size_t space = request->client()->space();
 
   size_t headLen = _head.length();
@@ -285,194 +320,301 @@ size_t AsyncAbstractResponse::_ack(AsyncWebServerRequest *request, size_t len, u
   }
 
   if(_state == RESPONSE_CONTENT){
+    // one pooled buffer holds a couple of segments, keep filling them while the window allows
+    size_t written = 0;
     size_t outLen;
-    if(_chunked){
-      if(space <= 8){
-        return 0;
-      }
-      outLen = space;
-    } else if(!_sendContentLength){
-      outLen = space;
-    } else {
-      outLen = ((_contentLength - _sentLength) > space)?space:(_contentLength - _sentLength);
+    while((outLen = _writeContent(request, space)) != 0){
+      written += outLen;
+      if(_state != RESPONSE_CONTENT || _tailLen)
+        break;
+      space = request->client()->space();
+      // without a length or chunks an empty fill ends the body, so never ask for nothing
+      if(!space)
+        break;
+    }
+    return written;
+
+  } else if(_state == RESPONSE_WAIT_ACK){
+    // buffers still waiting for their ack would turn the close into an abort
+    if(_ackedLength >= _writtenLength){
+      _state = RESPONSE_END;
+      if(!_chunked && !_sendContentLength)
+        request->client()->close(true);
     }
+  }
+  return 0;
+}
+
+size_t AsyncAbstractResponse::_writeTail(AsyncClient* client){
+  async_iovec_t iov = { _tail, _tailLen, _tailRelease, _tailArg };
+  size_t written = client->writev(&iov, 1);
+  // taken whole, the client releases the buffer once it is acked
+  _writtenLength += written;
+  _tail += written;
+  _tailLen -= written;
+  return written;
+}
 
-    uint8_t *buf = (uint8_t *)malloc(outLen+headLen);
-    if (!buf) {
-      // os_printf("_ack malloc %d failed\n", outLen+headLen);
+size_t AsyncAbstractResponse::_writeContent(AsyncWebServerRequest *request, size_t space){
+  size_t headLen = _head.length();
+  size_t outLen;
+  if(_chunked){
+    if(space <= 8){
       return 0;
     }
+    outLen = space;
+  } else if(!_sendContentLength){
+    outLen = space;
+  } else {
+    outLen = ((_contentLength - _sentLength) > space)?space:(_contentLength - _sentLength);
+  }
 
+  // Mapped content needs no buffer at all, only the head is copied
+  const uint8_t *mapped = NULL;
+  size_t mappedLen = 0;
+  AcBufferReleaseHandler release = NULL;
+  void* arg = NULL;
+  if(!_callback && !_chunked && _sendContentLength)
+    mappedLen = _mapBuffer(&mapped, outLen, &release, &arg);
+  if(mappedLen){
     if(headLen){
-      memcpy(buf, _head.c_str(), _head.length());
+      _writtenLength += request->client()->add(_head.c_str(), headLen, ASYNC_WRITE_FLAG_COPY | ASYNC_WRITE_FLAG_MORE);
+      _head = String();
     }
+    _tail = (const char*)mapped;
+    _tailLen = mappedLen;
+    _tailRelease = release;
+    _tailArg = arg;
+    _writeTail(request->client());
+    _sentLength += mappedLen;
+    if(_sentLength == _contentLength){
+      _state = RESPONSE_WAIT_ACK;
+    }
+    return headLen + mappedLen;
+  }
 
-    size_t readLen = 0;
+  // A pooled buffer is filled in place and handed to lwIP by reference,
+  // only when the pool is exhausted does the write get its own copy
+  uint8_t *buf = NULL;
+  if(_pool == NULL)
+    _pool = request->_sendBuffers();
+  if(_pool && headLen + 8 < _pool->size())
+    buf = _pool->acquire();
+  bool pooled = buf != NULL;
+  if(pooled){
+    if(outLen + headLen > _pool->size())
+      outLen = _pool->size() - headLen;
+  } else {
+    buf = (uint8_t *)malloc(outLen+headLen);
+  }
+  if (!buf) {
+    // os_printf("_ack malloc %d failed\n", outLen+headLen);
+    return 0;
+  }
 
-    if(_chunked){
-      // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
-      // See RFC2616 sections 2, 3.6.1.
-      readLen = _fillBufferAndProcessTemplates(buf+headLen+6, outLen - 8);
-      if(readLen == RESPONSE_TRY_AGAIN){
-          free(buf);
-          return 0;
-      }
-      outLen = sprintf((char*)buf+headLen, "%x", readLen) + headLen;
-      while(outLen < headLen + 4) buf[outLen++] = ' ';
-      buf[outLen++] = '\r';
-      buf[outLen++] = '\n';
-      outLen += readLen;
-      buf[outLen++] = '\r';
-      buf[outLen++] = '\n';
-    } else {
-      readLen = _fillBufferAndProcessTemplates(buf+headLen, outLen);
-      if(readLen == RESPONSE_TRY_AGAIN){
-          free(buf);
-          return 0;
-      }
-      outLen = readLen + headLen;
-    }
+  if(headLen){
+    memcpy(buf, _head.c_str(), _head.length());
+  }
 
-    if(headLen){
-        _head = String();
-    }
+  size_t readLen = 0;
 
-    if(outLen){
-        _writtenLength += request->client()->write((const char*)buf, outLen);
+  if(_chunked){
+    // HTTP 1.1 allows leading zeros in chunk length. Or spaces may be added.
+    // See RFC2616 sections 2, 3.6.1.
+    readLen = _fillBufferAndProcessTemplates(buf+headLen+6, outLen - 8);
+    if(readLen == RESPONSE_TRY_AGAIN){
+        if(pooled) _pool->release(buf); else free(buf);
+        return 0;
     }
-
-    if(_chunked){
-        _sentLength += readLen;
-    } else {
-        _sentLength += outLen - headLen;
+    outLen = sprintf((char*)buf+headLen, "%x", readLen) + headLen;
+    while(outLen < headLen + 4) buf[outLen++] = ' ';
+    buf[outLen++] = '\r';
+    buf[outLen++] = '\n';
+    outLen += readLen;
+    buf[outLen++] = '\r';
+    buf[outLen++] = '\n';
+  } else {
+    readLen = _fillBufferAndProcessTemplates(buf+headLen, outLen);
+    if(readLen == RESPONSE_TRY_AGAIN){
+        if(pooled) _pool->release(buf); else free(buf);
+        return 0;
     }
+    outLen = readLen + headLen;
+  }
 
-    free(buf);
+  if(headLen){
+      _head = String();
+  }
 
-    if((_chunked && readLen == 0) || (!_sendContentLength && outLen == 0) || (!_chunked && _sentLength == _contentLength)){
-      _state = RESPONSE_WAIT_ACK;
-    }
-    return outLen;
+  if(pooled && outLen){
+      _tail = (const char*)buf;
+      _tailLen = outLen;
+      _tailRelease = AsyncWebBufferPool::onRelease;
+      _tailArg = _pool;
+      _writeTail(request->client());
+  } else if(outLen){
+      _writtenLength += request->client()->write((const char*)buf, outLen);
+  }
 
-  } else if(_state == RESPONSE_WAIT_ACK){
-    if(!_sendContentLength || _ackedLength >= _writtenLength){
-      _state = RESPONSE_END;
-      if(!_chunked && !_sendContentLength)
-        request->client()->close(true);
-    }
+  if(_chunked){
+      _sentLength += readLen;
+  } else {
+      _sentLength += outLen - headLen;
   }
-  return 0;
+
+  if(!pooled){
+      free(buf);
+  } else if(!outLen){
+      _pool->release(buf);
+  }
+
+  if((_chunked && readLen == 0) || (!_sendContentLength && outLen == 0 && space) || (!_chunked && _sentLength == _contentLength)){
+    _state = RESPONSE_WAIT_ACK;
+  }
+  return outLen;
 }
 
-size_t AsyncAbstractResponse::_readDataFromCacheOrContent(uint8_t* data, const size_t len)
+size_t AsyncAbstractResponse::_readLookahead()
 {
-    // If we have something in cache, copy it to buffer
-    const size_t readFromCache = std::min(len, _cache.size());
-    if(readFromCache) {
-      memcpy(data, _cache.data(), readFromCache);
-      _cache.erase(_cache.begin(), _cache.begin() + readFromCache);
-    }
-    // If we need to read more...
-    const size_t needFromFile = len - readFromCache;
-    const size_t readFromContent = _fillBuffer(data + readFromCache, needFromFile);
-    return readFromCache + readFromContent;
+  if(_lookahead == NULL){
+    _lookahead = (uint8_t*)malloc(TEMPLATE_LOOKAHEAD);
+    if(_lookahead == NULL)
+      return RESPONSE_TRY_AGAIN;
+  }
+  _lookStart = 0;
+  _lookEnd = 0;
+  size_t readLen = _fillBuffer(_lookahead, TEMPLATE_LOOKAHEAD);
+  if(readLen != RESPONSE_TRY_AGAIN)
+    _lookEnd = readLen;
+  return readLen;
 }
 
 size_t AsyncAbstractResponse::_fillBufferAndProcessTemplates(uint8_t* data, size_t len)
 {
   if(!_callback)
     return _fillBuffer(data, len);
-
-  const size_t originalLen = len;
-  len = _readDataFromCacheOrContent(data, len);
-  // Now we've read 'len' bytes, either from cache or from file
-  // Search for template placeholders
-  uint8_t* pTemplateStart = data;
-  while((pTemplateStart < &data[len]) && (pTemplateStart = (uint8_t*)memchr(pTemplateStart, TEMPLATE_PLACEHOLDER, &data[len - 1] - pTemplateStart + 1))) { // data[0] ... data[len - 1]
-    uint8_t* pTemplateEnd = (pTemplateStart < &data[len - 1]) ? (uint8_t*)memchr(pTemplateStart + 1, TEMPLATE_PLACEHOLDER, &data[len - 1] - pTemplateStart) : nullptr;
-    // temporary buffer to hold parameter name
-    uint8_t buf[TEMPLATE_PARAM_NAME_LENGTH + 1];
-    String paramName;
-    // If closing placeholder is found:
-    if(pTemplateEnd) {
-      // prepare argument to callback
-      const size_t paramNameLength = std::min(sizeof(buf) - 1, (unsigned int)(pTemplateEnd - pTemplateStart - 1));
-      if(paramNameLength) {
-        memcpy(buf, pTemplateStart + 1, paramNameLength);
-        buf[paramNameLength] = 0;
-        paramName = String(reinterpret_cast<char*>(buf));
-      } else { // double percent sign encountered, this is single percent sign escaped.
-        // remove the 2nd percent sign
-        memmove(pTemplateEnd, pTemplateEnd + 1, &data[len] - pTemplateEnd - 1);
-        len += _readDataFromCacheOrContent(&data[len - 1], 1) - 1;
-        ++pTemplateStart;
+  if(_template)
+    return _fillBufferFromTemplate(data, len);
+
+  size_t outLen = 0;
+  while(outLen < len){
+    // The value of the last placeholder goes out first, however long it is
+    if(_valueSent < _value.length()){
+      const size_t n = std::min(len - outLen, (size_t)(_value.length() - _valueSent));
+      memcpy(data + outLen, _value.c_str() + _valueSent, n);
+      outLen += n;
+      _valueSent += n;
+      continue;
+    }
+    if(_lookStart == _lookEnd){
+      const size_t readLen = _readLookahead();
+      if(readLen == RESPONSE_TRY_AGAIN)
+        return outLen ? outLen : RESPONSE_TRY_AGAIN;
+      if(readLen == 0){
+        if(!_inName)
+          break;
+        // the content ended inside what looked like a placeholder, it was text after all
+        _inName = false;
+        _name[_nameLen] = 0;
+        _value = String((char)TEMPLATE_PLACEHOLDER);
+        _value += _name;
+        _valueSent = 0;
+        continue;
       }
-    } else if(&data[len - 1] - pTemplateStart + 1 < TEMPLATE_PARAM_NAME_LENGTH + 2) { // closing placeholder not found, check if it's in the remaining file data
-      memcpy(buf, pTemplateStart + 1, &data[len - 1] - pTemplateStart);
-      const size_t readFromCacheOrContent = _readDataFromCacheOrContent(buf + (&data[len - 1] - pTemplateStart), TEMPLATE_PARAM_NAME_LENGTH + 2 - (&data[len - 1] - pTemplateStart + 1));
-      if(readFromCacheOrContent) {
-        pTemplateEnd = (uint8_t*)memchr(buf + (&data[len - 1] - pTemplateStart), TEMPLATE_PLACEHOLDER, readFromCacheOrContent);
-        if(pTemplateEnd) {
-          // prepare argument to callback
-          *pTemplateEnd = 0;
-          paramName = String(reinterpret_cast<char*>(buf));
-          // Copy remaining read-ahead data into cache
-          _cache.insert(_cache.begin(), pTemplateEnd + 1, buf + (&data[len - 1] - pTemplateStart) + readFromCacheOrContent);
-          pTemplateEnd = &data[len - 1];
-        }
-        else // closing placeholder not found in file data, store found percent symbol as is and advance to the next position
-        {
-          // but first, store read file data in cache
-          _cache.insert(_cache.begin(), buf + (&data[len - 1] - pTemplateStart), buf + (&data[len - 1] - pTemplateStart) + readFromCacheOrContent);
-          ++pTemplateStart;
-        }
+    }
+    const uint8_t* p = _lookahead + _lookStart;
+    const size_t avail = _lookEnd - _lookStart;
+    if(!_inName){
+      // Copy text up to the next placeholder or the end of the buffer
+      size_t n = std::min(avail, len - outLen);
+      const uint8_t* mark = (const uint8_t*)memchr(p, TEMPLATE_PLACEHOLDER, n);
+      if(mark)
+        n = mark - p;
+      memcpy(data + outLen, p, n);
+      outLen += n;
+      _lookStart += n;
+      if(mark){
+        _lookStart++;
+        _inName = true;
+        _nameLen = 0;
       }
-      else // closing placeholder not found in content data, store found percent symbol as is and advance to the next position
-        ++pTemplateStart;
+      continue;
     }
-    else // closing placeholder not found in content data, store found percent symbol as is and advance to the next position
-      ++pTemplateStart;
-    if(paramName.length()) {
-      // call callback and replace with result.
-      // Everything in range [pTemplateStart, pTemplateEnd] can be safely replaced with parameter value.
-      // Data after pTemplateEnd may need to be moved.
-      // The first byte of data after placeholder is located at pTemplateEnd + 1.
-      // It should be located at pTemplateStart + numBytesCopied (to begin right after inserted parameter value).
-      const String paramValue(_callback(paramName));
-      const char* pvstr = paramValue.c_str();
-      const unsigned int pvlen = paramValue.length();
-      const size_t numBytesCopied = std::min(pvlen, static_cast<unsigned int>(&data[originalLen - 1] - pTemplateStart + 1));
-      // make room for param value
-      // 1. move extra data to cache if parameter value is longer than placeholder AND if there is no room to store
-      if((pTemplateEnd + 1 < pTemplateStart + numBytesCopied) && (originalLen - (pTemplateStart + numBytesCopied - pTemplateEnd - 1) < len)) {
-        _cache.insert(_cache.begin(), &data[originalLen - (pTemplateStart + numBytesCopied - pTemplateEnd - 1)], &data[len]);
-        //2. parameter value is longer than placeholder text, push the data after placeholder which not saved into cache further to the end
-        memmove(pTemplateStart + numBytesCopied, pTemplateEnd + 1, &data[originalLen] - pTemplateStart - numBytesCopied);
-        len = originalLen; // fix issue with truncated data, not sure if it has any side effects
-      } else if(pTemplateEnd + 1 != pTemplateStart + numBytesCopied)
-        //2. Either parameter value is shorter than placeholder text OR there is enough free space in buffer to fit.
-        //   Move the entire data after the placeholder
-        memmove(pTemplateStart + numBytesCopied, pTemplateEnd + 1, &data[len] - pTemplateEnd - 1);
-      // 3. replace placeholder with actual value
-      memcpy(pTemplateStart, pvstr, numBytesCopied);
-      // If result is longer than buffer, copy the remainder into cache (this could happen only if placeholder text itself did not fit entirely in buffer)
-      if(numBytesCopied < pvlen) {
-        _cache.insert(_cache.begin(), pvstr + numBytesCopied, pvstr + pvlen);
-      } else if(pTemplateStart + numBytesCopied < pTemplateEnd + 1) { // result is copied fully; if result is shorter than placeholder text...
-        // there is some free room, fill it from cache
-        const size_t roomFreed = pTemplateEnd + 1 - pTemplateStart - numBytesCopied;
-        const size_t totalFreeRoom = originalLen - len + roomFreed;
-        len += _readDataFromCacheOrContent(&data[len - roomFreed], totalFreeRoom) - roomFreed;
-      } else { // result is copied fully; it is longer than placeholder text
-        const size_t roomTaken = pTemplateStart + numBytesCopied - pTemplateEnd - 1;
-        len = std::min(len + roomTaken, originalLen);
+    // Collect the name, it may straddle several reads of the source
+    const uint8_t* mark = (const uint8_t*)memchr(p, TEMPLATE_PLACEHOLDER, avail);
+    const size_t n = mark ? (size_t)(mark - p) : avail;
+    const size_t take = std::min(n, (size_t)(TEMPLATE_PARAM_NAME_LENGTH - _nameLen));
+    memcpy(_name + _nameLen, p, take);
+    _nameLen += take;
+    _lookStart += take;
+    if(take < n){
+      // too long for a name, the percent sign is text and the scan carries on after it
+      _inName = false;
+      _name[_nameLen] = 0;
+      _value = String((char)TEMPLATE_PLACEHOLDER);
+      _value += _name;
+      _valueSent = 0;
+    } else if(mark){
+      _lookStart++;
+      _inName = false;
+      _name[_nameLen] = 0;
+      if(_nameLen){
+        _value = _callback(String(_name));
+      } else { // double percent sign encountered, this is single percent sign escaped.
+        _value = String((char)TEMPLATE_PLACEHOLDER);
       }
+      _valueSent = 0;
     }
-  } // while(pTemplateStart)
-  return len;
+  }
+  return outLen;
 }
 
 
+size_t AsyncAbstractResponse::_fillBufferFromTemplate(uint8_t* data, size_t len)
+{
+  size_t outLen = 0;
+  while(outLen < len){
+    if(_valueSent < _value.length()){
+      const size_t n = std::min(len - outLen, (size_t)(_value.length() - _valueSent));
+      memcpy(data + outLen, _value.c_str() + _valueSent, n);
+      outLen += n;
+      _valueSent += n;
+      continue;
+    }
+    if(_segment >= _template->segments())
+      break;
+    const AsyncWebTemplateSegment& s = _template->segment(_segment);
+    size_t readLen;
+    if(s.name == ASYNC_WEB_TEMPLATE_TEXT){
+      // text goes from the source straight into the buffer
+      readLen = _fillBuffer(data + outLen, std::min(len - outLen, (size_t)(s.length - _segmentRead)));
+      if(readLen != RESPONSE_TRY_AGAIN)
+        outLen += readLen;
+    } else {
+      // the placeholder itself is read past, its value takes its place
+      uint8_t skip[TEMPLATE_PARAM_NAME_LENGTH + 2];
+      readLen = _fillBuffer(skip, s.length - _segmentRead);
+    }
+    if(readLen == RESPONSE_TRY_AGAIN)
+      return outLen ? outLen : RESPONSE_TRY_AGAIN;
+    if(readLen == 0) // the source is shorter than when it was compiled
+      break;
+    _segmentRead += readLen;
+    if(_segmentRead < s.length)
+      continue;
+    if(s.name == ASYNC_WEB_TEMPLATE_ESCAPE){
+      _value = String((char)TEMPLATE_PLACEHOLDER);
+      _valueSent = 0;
+    } else if(s.name != ASYNC_WEB_TEMPLATE_TEXT){
+      _value = _callback(_template->name(s.name));
+      _valueSent = 0;
+    }
+    _segment++;
+    _segmentRead = 0;
+  }
+  return outLen;
+}
+
 /*
  * File Response
  * */
@@ -482,26 +624,40 @@ AsyncFileResponse::~AsyncFileResponse(){
     _content.close();
 }
 
+void AsyncFileResponse::_respond(AsyncWebServerRequest *request){
+  // templated files are split into text and placeholders once, then served from that
+  if(_callback && _content){
+    AsyncWebTemplateCache* templates = request->_templateCache();
+    if(templates)
+      _template = templates->get(_content, _path);
+  }
+  AsyncAbstractResponse::_respond(request);
+}
+
+static const char* contentTypeFor(const String& path){
+  if (path.endsWith(".html")) return "text/html";
+  else if (path.endsWith(".htm")) return "text/html";
+  else if (path.endsWith(".css")) return "text/css";
+  else if (path.endsWith(".json")) return "application/json";
+  else if (path.endsWith(".js")) return "application/javascript";
+  else if (path.endsWith(".png")) return "image/png";
+  else if (path.endsWith(".gif")) return "image/gif";
+  else if (path.endsWith(".jpg")) return "image/jpeg";
+  else if (path.endsWith(".ico")) return "image/x-icon";
+  else if (path.endsWith(".svg")) return "image/svg+xml";
+  else if (path.endsWith(".eot")) return "font/eot";
+  else if (path.endsWith(".woff")) return "font/woff";
+  else if (path.endsWith(".woff2")) return "font/woff2";
+  else if (path.endsWith(".ttf")) return "font/ttf";
+  else if (path.endsWith(".xml")) return "text/xml";
+  else if (path.endsWith(".pdf")) return "application/pdf";
+  else if (path.endsWith(".zip")) return "application/zip";
+  else if(path.endsWith(".gz")) return "application/x-gzip";
+  else return "text/plain";
+}
+
 void AsyncFileResponse::_setContentType(const String& path){
-  if (path.endsWith(".html")) _contentType = "text/html";
-  else if (path.endsWith(".htm")) _contentType = "text/html";
-  else if (path.endsWith(".css")) _contentType = "text/css";
-  else if (path.endsWith(".json")) _contentType = "application/json";
-  else if (path.endsWith(".js")) _contentType = "application/javascript";
-  else if (path.endsWith(".png")) _contentType = "image/png";
-  else if (path.endsWith(".gif")) _contentType = "image/gif";
-  else if (path.endsWith(".jpg")) _contentType = "image/jpeg";
-  else if (path.endsWith(".ico")) _contentType = "image/x-icon";
-  else if (path.endsWith(".svg")) _contentType = "image/svg+xml";
-  else if (path.endsWith(".eot")) _contentType = "font/eot";
-  else if (path.endsWith(".woff")) _contentType = "font/woff";
-  else if (path.endsWith(".woff2")) _contentType = "font/woff2";
-  else if (path.endsWith(".ttf")) _contentType = "font/ttf";
-  else if (path.endsWith(".xml")) _contentType = "text/xml";
-  else if (path.endsWith(".pdf")) _contentType = "application/pdf";
-  else if (path.endsWith(".zip")) _contentType = "application/zip";
-  else if(path.endsWith(".gz")) _contentType = "application/x-gzip";
-  else _contentType = "text/plain";
+  _contentType = contentTypeFor(path);
 }
 
 AsyncFileResponse::AsyncFileResponse(FS &fs, const String& path, const String& contentType, bool download, AwsTemplateProcessor callback): AsyncAbstractResponse(callback){
@@ -647,6 +803,8 @@ AsyncProgmemResponse::AsyncProgmemResponse(int code, const String& contentType,
   _contentType = contentType;
   _contentLength = len;
   _readLength = 0;
+  // a pointer into RAM may be gone before the data is acked, only flash is sent in place
+  _mapped = !callback && ASYNC_WEB_IN_FLASH(content);
 }
 
 size_t AsyncProgmemResponse::_fillBuffer(uint8_t *data, size_t len){
@@ -661,6 +819,60 @@ size_t AsyncProgmemResponse::_fillBuffer(uint8_t *data, size_t len){
   return left;
 }
 
+size_t AsyncProgmemResponse::_mapBuffer(const uint8_t **data, size_t len, AcBufferReleaseHandler *release, void **arg){
+  (void)release;
+  (void)arg;
+  if(!_mapped)
+    return 0;
+  size_t left = _contentLength - _readLength;
+  if (left > len)
+    left = len;
+  *data = _content + _readLength;
+  _readLength += left;
+  return left;
+}
+
+/*
+ * Asset Response (a static file the server keeps in RAM)
+ * */
+
+AsyncAssetResponse::AsyncAssetResponse(AsyncWebAsset* asset): AsyncAbstractResponse(nullptr) {
+  _code = 200;
+  _asset = asset;
+  _contentLength = asset->size();
+  _contentType = contentTypeFor(asset->path());
+  _readLength = 0;
+  if(asset->gzip())
+    addHeader("Content-Encoding", "gzip");
+}
+
+AsyncAssetResponse::~AsyncAssetResponse(){
+  _asset->release();
+}
+
+size_t AsyncAssetResponse::_fillBuffer(uint8_t *data, size_t len){
+  size_t left = _contentLength - _readLength;
+  if (left > len)
+    left = len;
+  memcpy(data, _asset->data() + _readLength, left);
+  _readLength += left;
+  return left;
+}
+
+size_t AsyncAssetResponse::_mapBuffer(const uint8_t **data, size_t len, AcBufferReleaseHandler *release, void **arg){
+  size_t left = _contentLength - _readLength;
+  if (left > len)
+    left = len;
+  if(!left)
+    return 0;
+  // every queued buffer keeps the asset alive until it is acked, the cache may drop it meanwhile
+  *data = _asset->data() + _readLength;
+  *release = AsyncWebAsset::onRelease;
+  *arg = _asset->retain();
+  _readLength += left;
+  return left;
+}
+
 
 /*
  * Response Stream (You can print/write/printf to it, up to the contentLen bytes)
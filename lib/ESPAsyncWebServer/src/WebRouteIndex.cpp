@@ -0,0 +1,195 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "WebRouteIndex.h"
+
+AsyncWebRouteIndex::AsyncWebRouteIndex()
+  : _root(nullptr)
+  , _unindexed(nullptr)
+  , _unindexedCount(0)
+  , _built(false)
+{}
+
+AsyncWebRouteIndex::~AsyncWebRouteIndex(){
+  clear();
+}
+
+void AsyncWebRouteIndex::_free(Node* node){
+  while(node != nullptr){
+    Node* sibling = node->sibling;
+    _free(node->child);
+    while(node->entries != nullptr){
+      Entry* e = node->entries;
+      node->entries = e->next;
+      delete e;
+    }
+    delete node;
+    node = sibling;
+  }
+}
+
+void AsyncWebRouteIndex::clear(){
+  _free(_root);
+  _root = nullptr;
+  free(_unindexed);
+  _unindexed = nullptr;
+  _unindexedCount = 0;
+  _built = false;
+}
+
+void AsyncWebRouteIndex::_insert(const String& path, Entry* entry){
+  Node* node = _root;
+  size_t i = 0;
+  while(i < path.length()){
+    Node** link = &node->child;
+    while(*link != nullptr && (*link)->label[0] != path[i]){
+      link = &(*link)->sibling;
+    }
+    Node* child = *link;
+    if(child == nullptr){
+      child = new Node(path.substring(i));
+      *link = child;
+      node = child;
+      break;
+    }
+    size_t common = 1;
+    while(common < child->label.length() && i + common < path.length() && child->label[common] == path[i + common]){
+      common++;
+    }
+    if(common < child->label.length()){
+      // split the edge where the paths part
+      Node* head = new Node(child->label.substring(0, common));
+      child->label = child->label.substring(common);
+      head->sibling = child->sibling;
+      child->sibling = nullptr;
+      head->child = child;
+      *link = head;
+      child = head;
+    }
+    node = child;
+    i += common;
+  }
+  // keep entries in registration order
+  Entry** tail = &node->entries;
+  while(*tail != nullptr){
+    tail = &(*tail)->next;
+  }
+  *tail = entry;
+}
+
+bool AsyncWebRouteIndex::build(LinkedList<AsyncWebHandler*>& handlers){
+  clear();
+  _root = new Node(String());
+  if(_root == nullptr){
+    return false;
+  }
+  size_t unindexed = 0;
+  for(const auto& h: handlers){
+    String path;
+    WebRequestMethodComposite methods = HTTP_ANY;
+    if(h->route(path, methods) == ROUTE_NONE){
+      unindexed++;
+    }
+  }
+  if(unindexed){
+    _unindexed = (AsyncWebRoute*)malloc(unindexed * sizeof(AsyncWebRoute));
+    if(_unindexed == nullptr){
+      clear();
+      return false;
+    }
+  }
+  uint16_t order = 0;
+  for(const auto& h: handlers){
+    String path;
+    WebRequestMethodComposite methods = HTTP_ANY;
+    WebRouteMatch match = h->route(path, methods);
+    if(match == ROUTE_NONE){
+      _unindexed[_unindexedCount++] = { order, h };
+    } else {
+      Entry* e = new Entry{ { order, h }, methods, match, nullptr };
+      if(e == nullptr){
+        clear();
+        return false;
+      }
+      _insert(path, e);
+    }
+    order++;
+  }
+  _built = true;
+  return true;
+}
+
+AsyncWebHandler* AsyncWebRouteIndex::find(AsyncWebServerRequest* request, bool* overflow) const {
+  AsyncWebRoute candidates[ASYNC_WEB_ROUTE_CANDIDATES];
+  size_t count = 0;
+  *overflow = false;
+
+  // walk the url down the trie, every node passed is a prefix of it
+  const char* url = request->url().c_str();
+  size_t len = request->url().length();
+  size_t i = 0;
+  const Node* node = _root;
+  while(node != nullptr){
+    for(const Entry* e = node->entries; e != nullptr; e = e->next){
+      if(!(e->methods & request->method())){
+        continue;
+      }
+      // exact paths also take anything below them
+      if(e->match == ROUTE_EXACT && i < len && url[i] != '/'){
+        continue;
+      }
+      if(count == ASYNC_WEB_ROUTE_CANDIDATES){
+        *overflow = true;
+        return nullptr;
+      }
+      // sorted insert, the trie hands them out by path length
+      size_t at = count++;
+      while(at && candidates[at - 1].order > e->route.order){
+        candidates[at] = candidates[at - 1];
+        at--;
+      }
+      candidates[at] = e->route;
+    }
+    const Node* next = nullptr;
+    if(i < len){
+      for(const Node* c = node->child; c != nullptr; c = c->sibling){
+        if(c->label[0] == url[i]){
+          if(c->label.length() <= len - i && !memcmp(c->label.c_str(), url + i, c->label.length())){
+            next = c;
+            i += c->label.length();
+          }
+          break;
+        }
+      }
+    }
+    node = next;
+  }
+
+  // merge with the handlers the index knows nothing about
+  size_t a = 0;
+  size_t b = 0;
+  while(a < count || b < _unindexedCount){
+    const AsyncWebRoute& r = (b == _unindexedCount || (a < count && candidates[a].order < _unindexed[b].order)) ? candidates[a++] : _unindexed[b++];
+    if(r.handler->filter(request) && r.handler->canHandle(request)){
+      return r.handler;
+    }
+  }
+  return nullptr;
+}
@@ -0,0 +1,78 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBROUTEINDEX_H_
+#define ASYNCWEBROUTEINDEX_H_
+
+#include "ESPAsyncWebServer.h"
+
+#ifndef ASYNC_WEB_ROUTE_CANDIDATES
+#define ASYNC_WEB_ROUTE_CANDIDATES 16 //indexed handlers matching one url, more than this falls back to asking every handler
+#endif
+
+// A handler with its position in the server's handler list, lower goes first
+struct AsyncWebRoute {
+  uint16_t order;
+  AsyncWebHandler* handler;
+};
+
+/*
+ * ROUTE INDEX :: Radix trie over the paths of the handlers that can describe their
+ * url (see AsyncWebHandler::route()). A lookup walks the url once to find the indexed
+ * handlers that may match and merges them with the ones that could not be indexed,
+ * in registration order. Only those get filter() and canHandle() called.
+ * */
+
+class AsyncWebRouteIndex {
+  private:
+    struct Entry {
+      AsyncWebRoute route;
+      WebRequestMethodComposite methods;
+      WebRouteMatch match;
+      Entry* next;
+    };
+    struct Node {
+      String label;
+      Node* child;
+      Node* sibling;
+      Entry* entries;
+      Node(const String& l) : label(l), child(nullptr), sibling(nullptr), entries(nullptr) {}
+    };
+    Node* _root;
+    AsyncWebRoute* _unindexed;
+    size_t _unindexedCount;
+    bool _built;
+
+    void _insert(const String& path, Entry* entry);
+    void _free(Node* node);
+
+  public:
+    AsyncWebRouteIndex();
+    ~AsyncWebRouteIndex();
+
+    bool build(LinkedList<AsyncWebHandler*>& handlers);
+    void clear();
+    bool built() const { return _built; }
+    // first handler in registration order that takes the request, overflow is set when
+    // too many indexed handlers matched and the caller has to ask all of them
+    AsyncWebHandler* find(AsyncWebServerRequest* request, bool* overflow) const;
+};
+
+#endif /* ASYNCWEBROUTEINDEX_H_ */
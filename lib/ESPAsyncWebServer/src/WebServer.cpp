@@ -20,6 +20,9 @@
 */
 #include "ESPAsyncWebServer.h"
 #include "WebHandlerImpl.h"
+#include "WebRouteIndex.h"
+#include "WebTemplate.h"
+#include "WebAssetCache.h"
 
 bool ON_STA_FILTER(AsyncWebServerRequest *request) {
   return WiFi.localIP() == request->client()->localIP();
@@ -34,7 +37,16 @@ AsyncWebServer::AsyncWebServer(uint16_t port)
   : _server(port)
   , _rewrites(LinkedList<AsyncWebRewrite*>([](AsyncWebRewrite* r){ delete r; }))
   , _handlers(LinkedList<AsyncWebHandler*>([](AsyncWebHandler* h){ delete h; }))
+  , _maxFormSize(ASYNC_WEB_MAX_FORM_SIZE)
+  , _maxHeaderSize(ASYNC_WEB_MAX_HEADER_SIZE)
+  , _maxBodySize(ASYNC_WEB_MAX_BODY_SIZE)
+  , _maxParams(ASYNC_WEB_MAX_PARAMS)
+  , _keepAliveTimeout(ASYNC_WEB_KEEPALIVE_TIMEOUT)
+  , _sendBuffers(ASYNC_WEB_SEND_BUFFERS, ASYNC_WEB_SEND_BUFFER_SIZE)
 {
+  _routes = new AsyncWebRouteIndex();
+  _templates = new AsyncWebTemplateCache(ASYNC_WEB_TEMPLATE_CACHE);
+  _assets = new AsyncWebAssetCache(ASYNC_WEB_ASSET_CACHE, ASYNC_WEB_ASSET_MAX_SIZE);
   _catchAllHandler = new AsyncCallbackWebHandler();
   if(_catchAllHandler == NULL)
     return;
@@ -55,6 +67,9 @@ AsyncWebServer::~AsyncWebServer(){
   reset();  
   end();
   if(_catchAllHandler) delete _catchAllHandler;
+  if(_routes) delete _routes;
+  if(_templates) delete _templates;
+  if(_assets) delete _assets;
 }
 
 AsyncWebRewrite& AsyncWebServer::addRewrite(AsyncWebRewrite* rewrite){
@@ -72,14 +87,17 @@ AsyncWebRewrite& AsyncWebServer::rewrite(const char* from, const char* to){
 
 AsyncWebHandler& AsyncWebServer::addHandler(AsyncWebHandler* handler){
   _handlers.add(handler);
+  if(_routes) _routes->clear();
   return *handler;
 }
 
 bool AsyncWebServer::removeHandler(AsyncWebHandler *handler){
+  if(_routes) _routes->clear();
   return _handlers.remove(handler);
 }
 
 void AsyncWebServer::begin(){
+  if(_routes) _routes->build(_handlers);
   _server.setNoDelay(true);
   _server.begin();
 }
@@ -88,6 +106,22 @@ void AsyncWebServer::end(){
   _server.end();
 }
 
+static const char * _refusal = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nRetry-After: 1\r\nConnection: close\r\n\r\n";
+
+void AsyncWebServer::setBacklog(uint8_t backlog){
+  _server.setBacklog(backlog);
+}
+
+void AsyncWebServer::setMaxClients(uint16_t max){
+  _server.setRefusal(_refusal);
+  _server.setMaxClients(max);
+}
+
+void AsyncWebServer::setAcceptRate(uint16_t per_second, uint16_t burst){
+  _server.setRefusal(_refusal);
+  _server.setAcceptRate(per_second, burst);
+}
+
 #if ASYNC_TCP_SSL_ENABLED
 void AsyncWebServer::onSslFileRequest(AcSSlFileHandler cb, void* arg){
   _server.onSslFileRequest(cb, arg);
@@ -98,10 +132,122 @@ void AsyncWebServer::beginSecure(const char *cert, const char *key, const char *
 }
 #endif
 
+void AsyncWebServer::setTemplateCache(size_t templates){
+  if(_templates) _templates->setCapacity(templates);
+}
+
+void AsyncWebServer::setAssetCache(size_t bytes, size_t maxFileSize){
+  if(_assets) _assets->setCapacity(bytes, maxFileSize);
+}
+
 void AsyncWebServer::_handleDisconnect(AsyncWebServerRequest *request){
   delete request;
 }
 
+/*
+ * Send Buffer Pool
+ * */
+
+AsyncWebBufferPool::AsyncWebBufferPool(size_t count, size_t size)
+  : _buffers(NULL)
+  , _count(0)
+  , _size(0)
+  , _allocated(0)
+  , _idle(0)
+{
+  _lock = portMUX_INITIALIZER_UNLOCKED;
+  configure(count, size);
+}
+
+AsyncWebBufferPool::~AsyncWebBufferPool(){
+  _free();
+}
+
+void AsyncWebBufferPool::_free(){
+  for(size_t i = 0; i < _allocated; i++)
+    free(_buffers[i]);
+  free(_buffers);
+  _buffers = NULL;
+  _allocated = 0;
+  _idle = 0;
+}
+
+bool AsyncWebBufferPool::configure(size_t count, size_t size){
+  portENTER_CRITICAL(&_lock);
+  bool busy = _idle != _allocated;
+  portEXIT_CRITICAL(&_lock);
+  if(busy)
+    return false;
+  _free();
+  _count = 0;
+  _size = size;
+  if(count == 0 || size == 0)
+    return true;
+  // buffers themselves are taken from the heap on first use and kept from then on
+  _buffers = (uint8_t**)calloc(count, sizeof(uint8_t*));
+  if(_buffers == NULL)
+    return false;
+  _count = count;
+  return true;
+}
+
+uint8_t* AsyncWebBufferPool::acquire(){
+  uint8_t* buf = NULL;
+  portENTER_CRITICAL(&_lock);
+  if(_idle){
+    // the idle buffers sit at the front, the last of them becomes the first one in flight
+    buf = _buffers[--_idle];
+  }
+  bool grow = buf == NULL && _allocated < _count;
+  if(grow)
+    _allocated++; //reserve the slot, malloc stays outside the critical section
+  portEXIT_CRITICAL(&_lock);
+  if(!grow)
+    return buf;
+  buf = (uint8_t*)malloc(_size);
+  portENTER_CRITICAL(&_lock);
+  // releases may have moved the reserved slot, it is still among the ones in flight
+  for(size_t i = _idle; i < _allocated; i++){
+    if(_buffers[i] == NULL){
+      _buffers[i] = _buffers[_allocated - 1];
+      _buffers[_allocated - 1] = buf;
+      break;
+    }
+  }
+  if(buf == NULL)
+    _allocated--;
+  portEXIT_CRITICAL(&_lock);
+  return buf;
+}
+
+void AsyncWebBufferPool::release(const uint8_t* data){
+  if(data == NULL)
+    return;
+  portENTER_CRITICAL(&_lock);
+  for(size_t i = _idle; i < _allocated; i++){
+    uint8_t* buf = _buffers[i];
+    if(buf != NULL && data >= buf && data < buf + _size){
+      _buffers[i] = _buffers[_idle];
+      _buffers[_idle] = buf;
+      _idle++;
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&_lock);
+}
+
+size_t AsyncWebBufferPool::available(){
+  portENTER_CRITICAL(&_lock);
+  size_t available = _idle + (_count - _allocated);
+  portEXIT_CRITICAL(&_lock);
+  return available;
+}
+
+void AsyncWebBufferPool::onRelease(void* arg, const char* data, size_t len){
+  (void)len;
+  ((AsyncWebBufferPool*)arg)->release((const uint8_t*)data);
+}
+
 void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request){
   for(const auto& r: _rewrites){
     if (r->match(request)){
@@ -112,12 +258,26 @@ void AsyncWebServer::_rewriteRequest(AsyncWebServerRequest *request){
 }
 
 void AsyncWebServer::_attachHandler(AsyncWebServerRequest *request){
-  for(const auto& h: _handlers){
-    if (h->filter(request) && h->canHandle(request)){
+  // handlers added after begin() invalidate the index, it is rebuilt on the next request
+  if(_routes && !_routes->built()){
+    _routes->build(_handlers);
+  }
+  bool overflow = true;
+  if(_routes && _routes->built()){
+    AsyncWebHandler* h = _routes->find(request, &overflow);
+    if(h != NULL){
       request->setHandler(h);
       return;
     }
   }
+  if(overflow){
+    for(const auto& h: _handlers){
+      if (h->filter(request) && h->canHandle(request)){
+        request->setHandler(h);
+        return;
+      }
+    }
+  }
   
   request->addInterestingHeader("ANY");
   request->setHandler(_catchAllHandler);
@@ -182,6 +342,7 @@ void AsyncWebServer::onRequestBody(ArBodyHandlerFunction fn){
 
 void AsyncWebServer::reset(){
   _rewrites.free();
+  if(_routes) _routes->clear();
   _handlers.free();
   
   if (_catchAllHandler != NULL){
@@ -0,0 +1,169 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#include "WebTemplate.h"
+
+/*
+ * Template
+ * */
+
+AsyncWebTemplate::AsyncWebTemplate(const String& path, size_t size, time_t lastWrite)
+  : _path(path)
+  , _size(size)
+  , _lastWrite(lastWrite)
+  , _compiled(false)
+  , _refs(0)
+  , _used(0)
+{}
+
+bool AsyncWebTemplate::_add(uint32_t length, uint16_t name){
+  if(_segments.size() >= ASYNC_WEB_TEMPLATE_SEGMENTS)
+    return false;
+  AsyncWebTemplateSegment s = { length, name };
+  _segments.push_back(s);
+  return true;
+}
+
+uint16_t AsyncWebTemplate::_intern(const char* name){
+  for(size_t i = 0; i < _names.size(); i++){
+    if(_names[i] == name)
+      return i;
+  }
+  _names.push_back(String(name));
+  return _names.size() - 1;
+}
+
+bool AsyncWebTemplate::compile(fs::File& file){
+  // Same rules as the streaming expansion in AsyncAbstractResponse: a name ends at the
+  // next sign within TEMPLATE_PARAM_NAME_LENGTH bytes, otherwise the sign is text
+  uint8_t buf[TEMPLATE_LOOKAHEAD];
+  char name[TEMPLATE_PARAM_NAME_LENGTH + 1];
+  size_t nameLen = 0;
+  bool inName = false;
+  uint32_t text = 0;
+  size_t readLen;
+  _segments.clear();
+  _names.clear();
+  _compiled = false;
+  while((readLen = file.read(buf, sizeof(buf))) > 0){
+    for(size_t i = 0; i < readLen; i++){
+      const uint8_t c = buf[i];
+      if(inName){
+        if(c == TEMPLATE_PLACEHOLDER){
+          inName = false;
+          if(text && !_add(text, ASYNC_WEB_TEMPLATE_TEXT))
+            return false;
+          text = 0;
+          name[nameLen] = 0;
+          if(!_add(nameLen + 2, nameLen ? _intern(name) : ASYNC_WEB_TEMPLATE_ESCAPE))
+            return false;
+          continue;
+        }
+        if(nameLen < TEMPLATE_PARAM_NAME_LENGTH){
+          name[nameLen++] = c;
+          continue;
+        }
+        // too long for a name, the sign and what followed it are text
+        inName = false;
+        text += nameLen + 1;
+      }
+      if(c == TEMPLATE_PLACEHOLDER){
+        inName = true;
+        nameLen = 0;
+      } else {
+        text++;
+      }
+    }
+  }
+  if(inName)
+    text += nameLen + 1;
+  if(text && !_add(text, ASYNC_WEB_TEMPLATE_TEXT))
+    return false;
+  _compiled = true;
+  return true;
+}
+
+/*
+ * Template Cache
+ * */
+
+AsyncWebTemplateCache::AsyncWebTemplateCache(size_t capacity)
+  : _templates(LinkedList<AsyncWebTemplate*>([](AsyncWebTemplate* t){ t->release(); }))
+  , _capacity(capacity)
+  , _clock(0)
+{}
+
+AsyncWebTemplateCache::~AsyncWebTemplateCache(){
+  clear();
+}
+
+AsyncWebTemplate* AsyncWebTemplateCache::get(fs::File& file, const String& path){
+  if(_capacity == 0 || !file)
+    return NULL;
+  const size_t size = file.size();
+  const time_t lastWrite = file.getLastWrite();
+  _clock++;
+  for(const auto& t: _templates){
+    if(t->matches(path, size, lastWrite)){
+      t->_used = _clock;
+      return t->_compiled ? t->retain() : NULL;
+    }
+  }
+
+  AsyncWebTemplate* t = new AsyncWebTemplate(path, size, lastWrite);
+  if(t == NULL)
+    return NULL;
+  // a file that does not compile is remembered too, so it is not read twice on every request
+  if(!t->compile(file)){
+    t->_segments.clear();
+    t->_names.clear();
+  }
+  file.seek(0);
+  t->_used = _clock;
+
+  invalidate(path);
+  _evict(_capacity - 1);
+  _templates.add(t->retain());
+  return t->_compiled ? t->retain() : NULL;
+}
+
+void AsyncWebTemplateCache::_evict(size_t keep){
+  while(_templates.length() > keep){
+    AsyncWebTemplate* oldest = _templates.front();
+    for(const auto& t: _templates){
+      if((int32_t)(t->_used - oldest->_used) < 0)
+        oldest = t;
+    }
+    _templates.remove(oldest);
+  }
+}
+
+void AsyncWebTemplateCache::invalidate(const String& path){
+  _templates.remove_first([&](AsyncWebTemplate* t){ return t->path() == path; });
+}
+
+void AsyncWebTemplateCache::clear(){
+  _templates.free();
+}
+
+void AsyncWebTemplateCache::setCapacity(size_t capacity){
+  _capacity = capacity;
+  _evict(_capacity);
+}
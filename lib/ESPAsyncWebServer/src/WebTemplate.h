@@ -0,0 +1,105 @@
+/*
+  Asynchronous WebServer library for Espressif MCUs
+
+  Copyright (c) 2016 Hristo Gochkov. All rights reserved.
+  This file is part of the esp8266 core for Arduino environment.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+#ifndef ASYNCWEBTEMPLATE_H_
+#define ASYNCWEBTEMPLATE_H_
+
+#include "ESPAsyncWebServer.h"
+#include "WebResponseImpl.h"
+
+#ifndef ASYNC_WEB_TEMPLATE_CACHE
+#define ASYNC_WEB_TEMPLATE_CACHE 8 //compiled templates kept in RAM, 0 expands every request while streaming
+#endif
+
+#ifndef ASYNC_WEB_TEMPLATE_SEGMENTS
+#define ASYNC_WEB_TEMPLATE_SEGMENTS 512 //files with more segments than this are never compiled
+#endif
+
+#define ASYNC_WEB_TEMPLATE_TEXT 0xFFFF //segment copied from the file as is
+#define ASYNC_WEB_TEMPLATE_ESCAPE 0xFFFE //doubled placeholder sign, sent as a single one
+
+// A run of the template file, either text or a placeholder with the index of its name
+struct AsyncWebTemplateSegment {
+  uint32_t length; //bytes of the file, signs included for placeholders
+  uint16_t name;
+};
+
+/*
+ * TEMPLATE :: A template file split into text and placeholders once, so serving it
+ * copies the text straight from the file and skips the placeholders without scanning.
+ * Responses hold a reference, the cache may drop it while they still send.
+ * */
+
+class AsyncWebTemplate {
+  private:
+    String _path;
+    size_t _size;
+    time_t _lastWrite;
+    std::vector<AsyncWebTemplateSegment> _segments;
+    std::vector<String> _names;
+    bool _compiled;
+    uint16_t _refs;
+    uint32_t _used;
+
+    bool _add(uint32_t length, uint16_t name);
+    uint16_t _intern(const char* name);
+
+  public:
+    AsyncWebTemplate(const String& path, size_t size, time_t lastWrite);
+
+    bool compile(fs::File& file); //reads the file to its end
+    bool matches(const String& path, size_t size, time_t lastWrite) const { return _size == size && _lastWrite == lastWrite && _path == path; }
+    bool compiled() const { return _compiled; }
+    const String& path() const { return _path; }
+    size_t segments() const { return _segments.size(); }
+    const AsyncWebTemplateSegment& segment(size_t i) const { return _segments[i]; }
+    const String& name(uint16_t i) const { return _names[i]; }
+
+    AsyncWebTemplate* retain(){ _refs++; return this; }
+    void release(){ if(--_refs == 0) delete this; }
+    friend class AsyncWebTemplateCache;
+};
+
+/*
+ * TEMPLATE CACHE :: The compiled templates of one server, least recently used goes first
+ * */
+
+class AsyncWebTemplateCache {
+  private:
+    LinkedList<AsyncWebTemplate*> _templates;
+    size_t _capacity;
+    uint32_t _clock;
+
+    void _evict(size_t keep);
+
+  public:
+    AsyncWebTemplateCache(size_t capacity);
+    ~AsyncWebTemplateCache();
+
+    // compiled template for the file, retained for the caller, NULL if it is not worth one.
+    // The file is read to compile it on the first request and put back at its start.
+    AsyncWebTemplate* get(fs::File& file, const String& path);
+    void invalidate(const String& path);
+    void clear();
+    void setCapacity(size_t capacity);
+    size_t capacity() const { return _capacity; }
+};
+
+#endif /* ASYNCWEBTEMPLATE_H_ */
@@ -456,23 +456,14 @@ void hndlWifichz(AsyncWebServerRequest *request) {
   String title = "<h2>Joining wifi network...</h2>";
   String message = "<p>Check <a href='/status'>wifi status</a>.</p>";
 
-  String ssid = "";
-  String key = "";
-  for(uint8_t i = 0; i < request->args(); i++ ) {
-    if(request->argName(i) == "ssid")
-      ssid = request->arg(i);
-    else if(request->argName(i) == "key")
-      key = request->arg(i);
-  }
+  // the form fields are decoded in the request's own buffer, no copies needed
+  const char *ssid = request->formArg("ssid");
+  const char *key = request->formArg("key");
 
-  if(ssid == "") {
+  if(ssid == NULL || *ssid == 0) {
     message = "<h2>Ooops, no SSID...?</h2>\n<p>Looks like a bug :-(</p>";
   } else {
-    char ssidchars[ssid.length()+1];
-    char keychars[key.length()+1];
-    ssid.toCharArray(ssidchars, ssid.length()+1);
-    key.toCharArray(keychars, key.length()+1);
-    WiFi.begin(ssidchars, keychars);
+    WiFi.begin(ssid, key ? key : "");
   }
 
   replacement_t repls[] = { // the elements to replace in the template
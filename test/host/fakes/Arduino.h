@@ -0,0 +1,52 @@
+/*
+ * Host stand-in for the Arduino core, the subset the libraries under lib/ use
+ * */
+
+#ifndef HOST_ARDUINO_H_
+#define HOST_ARDUINO_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "IPAddress.h"
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void yield();
+
+//0 silent, 1 errors, 2 warnings, 3 info, 4 debug, 5 verbose
+#ifndef ARDUHAL_LOG_LEVEL
+#define ARDUHAL_LOG_LEVEL 1
+#endif
+
+void host_log(char level, const char * fmt, ...) __attribute__ ((format (printf, 2, 3)));
+#define log_e(format, ...) do { if(ARDUHAL_LOG_LEVEL >= 1) host_log('E', format, ##__VA_ARGS__); } while(0)
+#define log_w(format, ...) do { if(ARDUHAL_LOG_LEVEL >= 2) host_log('W', format, ##__VA_ARGS__); } while(0)
+#define log_i(format, ...) do { if(ARDUHAL_LOG_LEVEL >= 3) host_log('I', format, ##__VA_ARGS__); } while(0)
+#define log_d(format, ...) do { if(ARDUHAL_LOG_LEVEL >= 4) host_log('D', format, ##__VA_ARGS__); } while(0)
+#define log_v(format, ...) do { if(ARDUHAL_LOG_LEVEL >= 5) host_log('V', format, ##__VA_ARGS__); } while(0)
+#define ets_printf printf
+
+//there is no separate program memory on the host
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define strlen_P strlen
+#define strcpy_P strcpy
+#define strncpy_P strncpy
+#define strcmp_P strcmp
+#define memcpy_P memcpy
+#define vsnprintf_P vsnprintf
+
+#endif /* HOST_ARDUINO_H_ */
@@ -0,0 +1,103 @@
+/*
+ * Host stand-in for the Arduino file system API.
+ *
+ * An FS keeps its files in memory, a test fills it through open(path, "w")
+ * like a sketch would. Directories are implied by the paths of the files in
+ * them. A File shares the file's contents, so a handle stays valid when the
+ * file is removed or rewritten, as on SPIFFS.
+ * */
+
+#ifndef HOST_FS_H_
+#define HOST_FS_H_
+
+#include <time.h>
+#include <memory>
+#include "Stream.h"
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode {
+    SeekSet = 0,
+    SeekCur = 1,
+    SeekEnd = 2
+};
+
+struct HostFileData;
+struct HostFSData;
+
+class File: public Stream {
+  public:
+    File() {}
+
+    size_t write(uint8_t) override;
+    size_t write(const uint8_t * buf, size_t size) override;
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override {}
+    size_t read(uint8_t * buf, size_t size);
+    size_t readBytes(char * buffer, size_t length) { return read((uint8_t *)buffer, length); }
+
+    bool seek(uint32_t pos, SeekMode mode);
+    bool seek(uint32_t pos) { return seek(pos, SeekSet); }
+    size_t position() const;
+    size_t size() const;
+    void close();
+    operator bool() const;
+    time_t getLastWrite();
+    const char * name() const;
+
+    bool isDirectory(void);
+    File openNextFile(const char * mode = FILE_READ);
+    void rewindDirectory(void);
+
+  private:
+    friend class FS;
+    std::shared_ptr<HostFileData> _file;
+    std::shared_ptr<HostFSData> _fs; //set for directories
+    std::string _path;
+    size_t _pos = 0;
+    size_t _next = 0; //directory listing position
+    bool _writable = false;
+};
+
+class FS {
+  public:
+    FS();
+
+    File open(const char * path, const char * mode = FILE_READ, const bool create = false);
+    File open(const String & path, const char * mode = FILE_READ, const bool create = false) { return open(path.c_str(), mode, create); }
+
+    bool exists(const char * path);
+    bool exists(const String & path) { return exists(path.c_str()); }
+
+    bool remove(const char * path);
+    bool remove(const String & path) { return remove(path.c_str()); }
+
+    bool rename(const char * pathFrom, const char * pathTo);
+    bool rename(const String & pathFrom, const String & pathTo) { return rename(pathFrom.c_str(), pathTo.c_str()); }
+
+    bool mkdir(const char * path) { return true; }
+    bool mkdir(const String & path) { return true; }
+
+    bool rmdir(const char * path) { return true; }
+    bool rmdir(const String & path) { return true; }
+
+  private:
+    std::shared_ptr<HostFSData> _data;
+};
+
+} // namespace fs
+
+using fs::FS;
+using fs::File;
+using fs::SeekMode;
+using fs::SeekSet;
+using fs::SeekCur;
+using fs::SeekEnd;
+
+#endif /* HOST_FS_H_ */
@@ -0,0 +1,29 @@
+#ifndef HOST_IPADDRESS_H_
+#define HOST_IPADDRESS_H_
+
+#include <stdint.h>
+
+//an IPv4 address in network byte order, as the Arduino core keeps it
+class IPAddress {
+  private:
+    union {
+        uint8_t bytes[4];
+        uint32_t dword;
+    } _address;
+
+  public:
+    IPAddress(){ _address.dword = 0; }
+    IPAddress(uint32_t address){ _address.dword = address; }
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d){
+        _address.bytes[0] = a;
+        _address.bytes[1] = b;
+        _address.bytes[2] = c;
+        _address.bytes[3] = d;
+    }
+    operator uint32_t() const { return _address.dword; }
+    bool operator==(const IPAddress& other) const { return _address.dword == other._address.dword; }
+    bool operator!=(const IPAddress& other) const { return _address.dword != other._address.dword; }
+    uint8_t operator[](int index) const { return _address.bytes[index]; }
+};
+
+#endif /* HOST_IPADDRESS_H_ */
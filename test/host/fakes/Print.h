@@ -0,0 +1,43 @@
+/*
+ * Host stand-in for the Arduino Print and Stream classes
+ * */
+
+#ifndef HOST_PRINT_H_
+#define HOST_PRINT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "WString.h"
+
+#define DEC 10
+#define HEX 16
+#define OCT 8
+#define BIN 2
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t) = 0;
+    virtual size_t write(const uint8_t * buffer, size_t size);
+    size_t write(const char * str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+    size_t write(const char * buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+    size_t printf(const char * format, ...) __attribute__ ((format (printf, 2, 3)));
+    size_t print(const __FlashStringHelper * str) { return write(reinterpret_cast<const char *>(str)); }
+    size_t print(const String & str) { return write(str.c_str(), str.length()); }
+    size_t print(const char * str) { return write(str); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(unsigned char num, int base = DEC) { return print(String(num, base)); }
+    size_t print(int num, int base = DEC) { return print(String(num, base)); }
+    size_t print(unsigned int num, int base = DEC) { return print(String(num, base)); }
+    size_t print(long num, int base = DEC) { return print(String(num, base)); }
+    size_t print(unsigned long num, int base = DEC) { return print(String(num, base)); }
+    size_t print(double num, int digits = 2) { return print(String(num, digits)); }
+
+    template <typename T>
+    size_t println(const T & value) { size_t n = print(value); return n + println(); }
+    size_t println() { return write("\r\n"); }
+};
+
+#endif /* HOST_PRINT_H_ */
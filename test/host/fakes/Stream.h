@@ -0,0 +1,16 @@
+#ifndef HOST_STREAM_H_
+#define HOST_STREAM_H_
+
+#include "Print.h"
+
+class Stream: public Print {
+  public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+    size_t readBytes(char * buffer, size_t length);
+    size_t readBytes(uint8_t * buffer, size_t length) { return readBytes((char *)buffer, length); }
+};
+
+#endif /* HOST_STREAM_H_ */
@@ -0,0 +1,218 @@
+#include "WString.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+
+static std::string _number(unsigned long long value, bool negative, unsigned char base){
+    char buf[8 * sizeof(value) + 2];
+    char * p = buf + sizeof(buf);
+    *--p = 0;
+    if(base < 2){
+        base = 10;
+    }
+    do {
+        unsigned digit = value % base;
+        *--p = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while(value);
+    if(negative){
+        *--p = '-';
+    }
+    return std::string(p);
+}
+
+static std::string _signed(long long value, unsigned char base){
+    //like the core, other bases show the two's complement
+    if(base != 10){
+        return _number((unsigned long long)value, false, base);
+    }
+    return _number(value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value, value < 0, base);
+}
+
+String::String(const char * cstr): _s(cstr ? cstr : "") {}
+String::String(const char * cstr, unsigned int length): _s(cstr ? std::string(cstr, length) : std::string()) {}
+String::String(unsigned char value, unsigned char base): _s(_number(value, false, base)) {}
+String::String(int value, unsigned char base): _s(base == 10 ? _signed(value, base) : _number((unsigned int)value, false, base)) {}
+String::String(unsigned int value, unsigned char base): _s(_number(value, false, base)) {}
+String::String(long value, unsigned char base): _s(base == 10 ? _signed(value, base) : _number((unsigned long)value, false, base)) {}
+String::String(unsigned long value, unsigned char base): _s(_number(value, false, base)) {}
+String::String(long long value, unsigned char base): _s(_signed(value, base)) {}
+String::String(unsigned long long value, unsigned char base): _s(_number(value, false, base)) {}
+
+String::String(float value, unsigned int decimalPlaces): String((double)value, decimalPlaces) {}
+
+String::String(double value, unsigned int decimalPlaces){
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimalPlaces, value);
+    _s.assign(buf);
+}
+
+bool String::reserve(unsigned int size){
+    _s.reserve(size);
+    return true;
+}
+
+bool String::equalsIgnoreCase(const String & s) const {
+    return _s.size() == s._s.size() && !strcasecmp(c_str(), s.c_str());
+}
+
+bool String::startsWith(const String & prefix, unsigned int offset) const {
+    if(offset > _s.size() || prefix._s.size() > _s.size() - offset){
+        return false;
+    }
+    return !_s.compare(offset, prefix._s.size(), prefix._s);
+}
+
+bool String::endsWith(const String & suffix) const {
+    if(suffix._s.size() > _s.size()){
+        return false;
+    }
+    return !_s.compare(_s.size() - suffix._s.size(), suffix._s.size(), suffix._s);
+}
+
+char & String::operator [](unsigned int index){
+    static char dummy;
+    if(index >= _s.size()){
+        dummy = 0;
+        return dummy;
+    }
+    return _s[index];
+}
+
+void String::getBytes(unsigned char * buf, unsigned int bufsize, unsigned int index) const {
+    if(!bufsize || !buf){
+        return;
+    }
+    if(index >= _s.size()){
+        buf[0] = 0;
+        return;
+    }
+    unsigned int n = bufsize - 1;
+    if(n > _s.size() - index){
+        n = _s.size() - index;
+    }
+    memcpy(buf, _s.data() + index, n);
+    buf[n] = 0;
+}
+
+int String::indexOf(char ch, unsigned int fromIndex) const {
+    if(fromIndex >= _s.size()){
+        return -1;
+    }
+    size_t pos = _s.find(ch, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String & str, unsigned int fromIndex) const {
+    if(fromIndex >= _s.size()){
+        return -1;
+    }
+    size_t pos = _s.find(str._s, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch, unsigned int fromIndex) const {
+    if(fromIndex >= _s.size()){
+        return -1;
+    }
+    size_t pos = _s.rfind(ch, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String & str, unsigned int fromIndex) const {
+    if(str._s.size() > _s.size() || fromIndex >= _s.size()){
+        return -1;
+    }
+    size_t pos = _s.rfind(str._s, fromIndex);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int left, unsigned int right) const {
+    if(left > right){
+        unsigned int t = left;
+        left = right;
+        right = t;
+    }
+    if(left >= _s.size()){
+        return String();
+    }
+    if(right > _s.size()){
+        right = _s.size();
+    }
+    return String(_s.data() + left, right - left);
+}
+
+void String::replace(char find, char replace){
+    for(char & c : _s){
+        if(c == find){
+            c = replace;
+        }
+    }
+}
+
+void String::replace(const String & find, const String & replace){
+    if(find._s.empty()){
+        return;
+    }
+    size_t pos = 0;
+    while((pos = _s.find(find._s, pos)) != std::string::npos){
+        _s.replace(pos, find._s.size(), replace._s);
+        pos += replace._s.size();
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count){
+    if(index >= _s.size()){
+        return;
+    }
+    _s.erase(index, count);
+}
+
+void String::toLowerCase(){
+    for(char & c : _s){
+        c = tolower((unsigned char)c);
+    }
+}
+
+void String::toUpperCase(){
+    for(char & c : _s){
+        c = toupper((unsigned char)c);
+    }
+}
+
+void String::trim(){
+    size_t begin = 0;
+    while(begin < _s.size() && isspace((unsigned char)_s[begin])){
+        begin++;
+    }
+    size_t end = _s.size();
+    while(end > begin && isspace((unsigned char)_s[end - 1])){
+        end--;
+    }
+    _s = _s.substr(begin, end - begin);
+}
+
+String operator +(const String & lhs, const String & rhs){
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator +(const String & lhs, const char * rhs){
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator +(const char * lhs, const String & rhs){
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator +(const String & lhs, char rhs){
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
@@ -0,0 +1,134 @@
+/*
+ * Host stand-in for the Arduino String.
+ *
+ * Same interface and the same out of range behaviour as the core's String
+ * (indexOf() gives -1, substring() clamps, a NULL char pointer is an empty
+ * string). The characters live in a std::string, so every growth goes
+ * through the counted allocator like the core's realloc() does.
+ * */
+
+#ifndef HOST_WSTRING_H_
+#define HOST_WSTRING_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+class __FlashStringHelper;
+#define FPSTR(pstr_pointer) (reinterpret_cast<const __FlashStringHelper *>(pstr_pointer))
+#define F(string_literal) (FPSTR(string_literal))
+
+class String {
+  public:
+    String(const char * cstr = "");
+    String(const char * cstr, unsigned int length);
+    String(const String & str): _s(str._s) {}
+    String(String && str): _s(std::move(str._s)) {}
+    String(const __FlashStringHelper * str): String(reinterpret_cast<const char *>(str)) {}
+    explicit String(char c): _s(1, c) {}
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+    explicit String(long long value, unsigned char base = 10);
+    explicit String(unsigned long long value, unsigned char base = 10);
+    explicit String(float value, unsigned int decimalPlaces = 2);
+    explicit String(double value, unsigned int decimalPlaces = 2);
+
+    bool reserve(unsigned int size);
+    unsigned int length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    void clear() { _s.clear(); }
+
+    String & operator =(const String & rhs) { _s = rhs._s; return *this; }
+    String & operator =(String && rhs) { _s = std::move(rhs._s); return *this; }
+    String & operator =(const char * cstr) { _s.assign(cstr ? cstr : ""); return *this; }
+    String & operator =(const __FlashStringHelper * str) { return *this = reinterpret_cast<const char *>(str); }
+
+    bool concat(const String & str) { _s.append(str._s); return true; }
+    bool concat(const char * cstr) { if(cstr) _s.append(cstr); return true; }
+    bool concat(const char * cstr, unsigned int length) { if(cstr) _s.append(cstr, length); return true; }
+    bool concat(const uint8_t * cstr, unsigned int length) { return concat((const char *)cstr, length); }
+    bool concat(const __FlashStringHelper * str) { return concat(reinterpret_cast<const char *>(str)); }
+    bool concat(char c) { _s.push_back(c); return true; }
+    bool concat(unsigned char num) { return concat(String(num)); }
+    bool concat(int num) { return concat(String(num)); }
+    bool concat(unsigned int num) { return concat(String(num)); }
+    bool concat(long num) { return concat(String(num)); }
+    bool concat(unsigned long num) { return concat(String(num)); }
+    bool concat(long long num) { return concat(String(num)); }
+    bool concat(unsigned long long num) { return concat(String(num)); }
+    bool concat(float num) { return concat(String(num)); }
+    bool concat(double num) { return concat(String(num)); }
+
+    template <typename T>
+    String & operator +=(const T & rhs) { concat(rhs); return *this; }
+
+    int compareTo(const String & s) const { return _s.compare(s._s); }
+    bool equals(const String & s) const { return _s == s._s; }
+    bool equals(const char * cstr) const { return _s == (cstr ? cstr : ""); }
+    bool operator ==(const String & rhs) const { return equals(rhs); }
+    bool operator ==(const char * cstr) const { return equals(cstr); }
+    bool operator !=(const String & rhs) const { return !equals(rhs); }
+    bool operator !=(const char * cstr) const { return !equals(cstr); }
+    bool operator <(const String & rhs) const { return compareTo(rhs) < 0; }
+    bool operator >(const String & rhs) const { return compareTo(rhs) > 0; }
+    bool operator <=(const String & rhs) const { return compareTo(rhs) <= 0; }
+    bool operator >=(const String & rhs) const { return compareTo(rhs) >= 0; }
+    bool equalsIgnoreCase(const String & s) const;
+    bool equalsConstantTime(const String & s) const { return equals(s); }
+    bool startsWith(const String & prefix) const { return startsWith(prefix, 0); }
+    bool startsWith(const String & prefix, unsigned int offset) const;
+    bool endsWith(const String & suffix) const;
+
+    char charAt(unsigned int index) const { return index < _s.size() ? _s[index] : 0; }
+    void setCharAt(unsigned int index, char c) { if(index < _s.size()) _s[index] = c; }
+    char operator [](unsigned int index) const { return charAt(index); }
+    char & operator [](unsigned int index);
+    void getBytes(unsigned char * buf, unsigned int bufsize, unsigned int index = 0) const;
+    void toCharArray(char * buf, unsigned int bufsize, unsigned int index = 0) const { getBytes((unsigned char *)buf, bufsize, index); }
+    const char * c_str() const { return _s.c_str(); }
+    char * begin() { return &_s[0]; }
+    char * end() { return &_s[0] + _s.size(); }
+    const char * begin() const { return c_str(); }
+    const char * end() const { return c_str() + _s.size(); }
+
+    int indexOf(char ch, unsigned int fromIndex = 0) const;
+    int indexOf(const String & str, unsigned int fromIndex = 0) const;
+    int lastIndexOf(char ch) const { return lastIndexOf(ch, _s.size() - 1); }
+    int lastIndexOf(char ch, unsigned int fromIndex) const;
+    int lastIndexOf(const String & str) const { return lastIndexOf(str, _s.size() - str.length()); }
+    int lastIndexOf(const String & str, unsigned int fromIndex) const;
+    String substring(unsigned int beginIndex) const { return substring(beginIndex, _s.size()); }
+    String substring(unsigned int beginIndex, unsigned int endIndex) const;
+
+    void replace(char find, char replace);
+    void replace(const String & find, const String & replace);
+    void remove(unsigned int index) { remove(index, (unsigned int)-1); }
+    void remove(unsigned int index, unsigned int count);
+    void toLowerCase();
+    void toUpperCase();
+    void trim();
+
+    //true for every String, as in the core where the buffer is never NULL
+    typedef void (String::*StringIfHelperType)() const;
+    void StringIfHelper() const {}
+    operator StringIfHelperType() const { return &String::StringIfHelper; }
+
+    long toInt() const { return atol(c_str()); }
+    float toFloat() const { return (float)atof(c_str()); }
+    double toDouble() const { return atof(c_str()); }
+
+  private:
+    std::string _s;
+};
+
+String operator +(const String & lhs, const String & rhs);
+String operator +(const String & lhs, const char * rhs);
+String operator +(const char * lhs, const String & rhs);
+String operator +(const String & lhs, char rhs);
+
+#endif /* HOST_WSTRING_H_ */
@@ -0,0 +1,18 @@
+/*
+ * Host stand-in for the WiFi library: the station has the loopback address
+ * */
+
+#ifndef HOST_WIFI_H_
+#define HOST_WIFI_H_
+
+#include "Arduino.h"
+
+class WiFiClass {
+  public:
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+    IPAddress softAPIP() { return IPAddress(127, 0, 0, 1); }
+};
+
+extern WiFiClass WiFi;
+
+#endif /* HOST_WIFI_H_ */
@@ -0,0 +1,33 @@
+#include "Arduino.h"
+#include "WiFi.h"
+#include <chrono>
+#include <thread>
+
+WiFiClass WiFi;
+
+static const std::chrono::steady_clock::time_point _started = std::chrono::steady_clock::now();
+
+unsigned long millis(){
+    return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - _started).count();
+}
+
+unsigned long micros(){
+    return (unsigned long)(uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _started).count();
+}
+
+void delay(uint32_t ms){
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void yield(){
+    std::this_thread::yield();
+}
+
+void host_log(char level, const char * fmt, ...){
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "[%c] ", level);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+    va_end(args);
+}
@@ -0,0 +1,28 @@
+#include "libb64/cencode.h"
+
+static const char _alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int base64_encode_chars(const char * plaintext_in, int length_in, char * code_out){
+    const unsigned char * in = (const unsigned char *)plaintext_in;
+    char * out = code_out;
+    int i = 0;
+    for(; i + 2 < length_in; i += 3){
+        *out++ = _alphabet[in[i] >> 2];
+        *out++ = _alphabet[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+        *out++ = _alphabet[((in[i + 1] & 0x0F) << 2) | (in[i + 2] >> 6)];
+        *out++ = _alphabet[in[i + 2] & 0x3F];
+    }
+    if(i < length_in){
+        *out++ = _alphabet[in[i] >> 2];
+        if(i + 1 < length_in){
+            *out++ = _alphabet[((in[i] & 0x03) << 4) | (in[i + 1] >> 4)];
+            *out++ = _alphabet[(in[i + 1] & 0x0F) << 2];
+        } else {
+            *out++ = _alphabet[(in[i] & 0x03) << 4];
+            *out++ = '=';
+        }
+        *out++ = '=';
+    }
+    *out = 0;
+    return out - code_out;
+}
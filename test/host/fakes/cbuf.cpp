@@ -0,0 +1,111 @@
+#include "cbuf.h"
+#include <stdint.h>
+#include <string.h>
+
+//one byte stays unused to tell a full buffer from an empty one, as in the core
+cbuf::cbuf(size_t size): _size(size), _buf(new char[size]), _bufend(_buf + size), _begin(_buf), _end(_buf) {}
+
+cbuf::~cbuf(){
+    delete[] _buf;
+}
+
+size_t cbuf::resizeAdd(size_t addSize){
+    return resize(_size + addSize);
+}
+
+size_t cbuf::resize(size_t newSize){
+    size_t bytes = available();
+    if(newSize < bytes + 1){
+        return _size;
+    }
+    char * buf = new char[newSize];
+    read(buf, bytes);
+    delete[] _buf;
+    _buf = buf;
+    _size = newSize;
+    _bufend = _buf + newSize;
+    _begin = _buf;
+    _end = _buf + bytes;
+    return _size;
+}
+
+size_t cbuf::available() const {
+    if(_end >= _begin){
+        return _end - _begin;
+    }
+    return _size - (_begin - _end);
+}
+
+size_t cbuf::room() const {
+    if(_end >= _begin){
+        return _size - (_end - _begin) - 1;
+    }
+    return _begin - _end - 1;
+}
+
+int cbuf::peek(){
+    if(empty()){
+        return -1;
+    }
+    return (uint8_t)*_begin;
+}
+
+int cbuf::read(){
+    if(empty()){
+        return -1;
+    }
+    char c = *_begin;
+    _begin = _wrap(_begin + 1);
+    return (uint8_t)c;
+}
+
+size_t cbuf::read(char * dst, size_t size){
+    size_t bytes = available();
+    if(size > bytes){
+        size = bytes;
+    }
+    size_t left = size;
+    while(left){
+        size_t run = (_end >= _begin) ? (size_t)(_end - _begin) : (size_t)(_bufend - _begin);
+        if(run > left){
+            run = left;
+        }
+        memcpy(dst, _begin, run);
+        dst += run;
+        left -= run;
+        _begin = _wrap(_begin + run);
+    }
+    return size;
+}
+
+size_t cbuf::write(char c){
+    if(full()){
+        return 0;
+    }
+    *_end = c;
+    _end = _wrap(_end + 1);
+    return 1;
+}
+
+size_t cbuf::write(const char * src, size_t size){
+    size_t bytes = room();
+    if(size > bytes){
+        size = bytes;
+    }
+    size_t left = size;
+    while(left){
+        size_t run = (_end >= _begin) ? (size_t)(_bufend - _end) : (size_t)(_begin - _end);
+        if(_end >= _begin && _begin == _buf){
+            //the byte before _begin stays free
+            run--;
+        }
+        if(run > left){
+            run = left;
+        }
+        memcpy(_end, src, run);
+        src += run;
+        left -= run;
+        _end = _wrap(_end + run);
+    }
+    return size;
+}
@@ -0,0 +1,15 @@
+#ifndef HOST_ESP_TASK_WDT_H_
+#define HOST_ESP_TASK_WDT_H_
+
+#include "freertos/FreeRTOS.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+//there is no watchdog on the host
+static inline esp_err_t esp_task_wdt_add(TaskHandle_t task){ return ESP_OK; }
+static inline esp_err_t esp_task_wdt_delete(TaskHandle_t task){ return ESP_OK; }
+static inline esp_err_t esp_task_wdt_reset(void){ return ESP_OK; }
+
+#endif /* HOST_ESP_TASK_WDT_H_ */
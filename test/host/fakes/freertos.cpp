@@ -0,0 +1,237 @@
+#include "freertos/FreeRTOS.h"
+#include "host_alloc.h"
+#include "host_freertos.h"
+#include <pthread.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Queues
+ * */
+
+struct QueueDefinition {
+    std::mutex lock;
+    std::condition_variable readable;
+    std::condition_variable writable;
+    std::vector<uint8_t> items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+static std::mutex _queues_lock;
+static std::vector<QueueDefinition *> _queues;
+
+//waits on cv until ready() or the ticks run out, portMAX_DELAY waits forever
+template<typename Ready>
+static bool _wait(std::condition_variable & cv, std::unique_lock<std::mutex> & lock, TickType_t wait, Ready ready){
+    if(wait == portMAX_DELAY){
+        cv.wait(lock, ready);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(wait), ready);
+}
+
+static BaseType_t _send(QueueHandle_t queue, const void * item, TickType_t wait, bool front){
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if(!_wait(queue->writable, lock, wait, [queue]{ return queue->count < queue->length; })){
+        return errQUEUE_FULL;
+    }
+    UBaseType_t slot;
+    if(front){
+        queue->head = (queue->head + queue->length - 1) % queue->length;
+        slot = queue->head;
+    } else {
+        slot = (queue->head + queue->count) % queue->length;
+    }
+    if(queue->item_size){
+        memcpy(&queue->items[slot * queue->item_size], item, queue->item_size);
+    }
+    queue->count++;
+    queue->readable.notify_one();
+    return pdPASS;
+}
+
+static BaseType_t _receive(QueueHandle_t queue, void * item, TickType_t wait, bool peek){
+    std::unique_lock<std::mutex> lock(queue->lock);
+    if(!_wait(queue->readable, lock, wait, [queue]{ return queue->count > 0; })){
+        return pdFAIL;
+    }
+    if(queue->item_size){
+        memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+    }
+    if(!peek){
+        queue->head = (queue->head + 1) % queue->length;
+        queue->count--;
+        queue->writable.notify_one();
+    } else {
+        queue->readable.notify_one();
+    }
+    return pdPASS;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size){
+    QueueDefinition * queue = new QueueDefinition();
+    queue->items.resize(length * item_size);
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->head = 0;
+    queue->count = 0;
+    HostAllocQuiet quiet;
+    std::lock_guard<std::mutex> lock(_queues_lock);
+    _queues.push_back(queue);
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue){
+    if(!queue){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(_queues_lock);
+        for(size_t i = 0; i < _queues.size(); i++){
+            if(_queues[i] == queue){
+                _queues.erase(_queues.begin() + i);
+                break;
+            }
+        }
+    }
+    delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void * item, TickType_t wait){
+    return _send(queue, item, wait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t queue, const void * item, TickType_t wait){
+    return _send(queue, item, wait, true);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void * item, TickType_t wait){
+    return _receive(queue, item, wait, false);
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void * item, TickType_t wait){
+    return _receive(queue, item, wait, true);
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue){
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->count;
+}
+
+UBaseType_t uxQueueSpacesAvailable(QueueHandle_t queue){
+    std::lock_guard<std::mutex> lock(queue->lock);
+    return queue->length - queue->count;
+}
+
+UBaseType_t host_queue_min_space(){
+    std::lock_guard<std::mutex> lock(_queues_lock);
+    UBaseType_t space = 0xFFFF;
+    for(QueueDefinition * queue : _queues){
+        if(queue->length > 1){
+            UBaseType_t free = uxQueueSpacesAvailable(queue);
+            if(free < space){
+                space = free;
+            }
+        }
+    }
+    return space;
+}
+
+/*
+ * Semaphores
+ * */
+
+SemaphoreHandle_t xSemaphoreCreateBinary(){
+    return xQueueCreate(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(){
+    SemaphoreHandle_t semaphore = xQueueCreate(1, 0);
+    xSemaphoreGive(semaphore);
+    return semaphore;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t wait){
+    return _receive(semaphore, NULL, wait, false);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore){
+    return _send(semaphore, NULL, 0, false);
+}
+
+/*
+ * Tasks
+ * */
+
+typedef struct {
+    TaskFunction_t fn;
+    void * arg;
+    const char * name;
+} host_task_t;
+
+static thread_local host_task_t * _current_task = NULL;
+static thread_local host_task_t _unnamed_task = { NULL, NULL, "main" };
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char * name, uint32_t stack, void * arg, UBaseType_t priority, TaskHandle_t * handle){
+    HostAllocQuiet quiet;
+    host_task_t * task = new host_task_t{ fn, arg, name };
+    std::thread([task]{
+        _current_task = task;
+        pthread_setname_np(pthread_self(), task->name);
+        task->fn(task->arg);
+    }).detach();
+    if(handle){
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+//priorities and cores mean nothing to the host scheduler
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char * name, uint32_t stack, void * arg, UBaseType_t priority, TaskHandle_t * handle, BaseType_t core){
+    return xTaskCreate(fn, name, stack, arg, priority, handle);
+}
+
+BaseType_t xTaskCreateUniversal(TaskFunction_t fn, const char * name, uint32_t stack, void * arg, UBaseType_t priority, TaskHandle_t * handle, BaseType_t core){
+    return xTaskCreate(fn, name, stack, arg, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t task){
+    if(task == NULL || task == _current_task){
+        pthread_exit(NULL);
+    }
+    //another thread cannot be stopped from outside, the tasks under test never need it
+}
+
+void vTaskDelay(TickType_t ticks){
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount(){
+    static const std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(){
+    return _current_task ? _current_task : &_unnamed_task;
+}
+
+/*
+ * Critical sections
+ * */
+
+void vPortEnterCritical(portMUX_TYPE * mux){
+    while(__atomic_exchange_n(&mux->locked, 1, __ATOMIC_ACQUIRE)){
+        std::this_thread::yield();
+    }
+}
+
+void vPortExitCritical(portMUX_TYPE * mux){
+    __atomic_store_n(&mux->locked, 0, __ATOMIC_RELEASE);
+}
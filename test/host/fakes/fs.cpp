@@ -0,0 +1,181 @@
+#include "FS.h"
+#include <map>
+#include <string>
+
+namespace fs {
+
+struct HostFileData {
+    std::string content;
+    time_t written;
+};
+
+struct HostFSData {
+    std::map<std::string, std::shared_ptr<HostFileData>> files;
+};
+
+size_t File::write(uint8_t c){
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t * buf, size_t size){
+    if(!_file || !_writable){
+        return 0;
+    }
+    std::string & content = _file->content;
+    if(_pos > content.size()){
+        _pos = content.size();
+    }
+    content.replace(_pos, size < content.size() - _pos ? size : content.size() - _pos, (const char *)buf, size);
+    _pos += size;
+    _file->written = time(NULL);
+    return size;
+}
+
+int File::available(){
+    if(!_file || _pos >= _file->content.size()){
+        return 0;
+    }
+    return _file->content.size() - _pos;
+}
+
+int File::read(){
+    uint8_t c;
+    return read(&c, 1) ? c : -1;
+}
+
+int File::peek(){
+    if(!available()){
+        return -1;
+    }
+    return (uint8_t)_file->content[_pos];
+}
+
+size_t File::read(uint8_t * buf, size_t size){
+    size_t left = available();
+    if(size > left){
+        size = left;
+    }
+    if(size){
+        memcpy(buf, _file->content.data() + _pos, size);
+        _pos += size;
+    }
+    return size;
+}
+
+bool File::seek(uint32_t pos, SeekMode mode){
+    if(!_file){
+        return false;
+    }
+    size_t base = (mode == SeekSet) ? 0 : (mode == SeekCur) ? _pos : _file->content.size();
+    if(base + pos > _file->content.size()){
+        return false;
+    }
+    _pos = base + pos;
+    return true;
+}
+
+size_t File::position() const {
+    return _pos;
+}
+
+size_t File::size() const {
+    return _file ? _file->content.size() : 0;
+}
+
+void File::close(){
+    _file.reset();
+    _fs.reset();
+}
+
+File::operator bool() const {
+    return _file || _fs;
+}
+
+time_t File::getLastWrite(){
+    return _file ? _file->written : 0;
+}
+
+const char * File::name() const {
+    return _path.c_str();
+}
+
+bool File::isDirectory(void){
+    return (bool)_fs;
+}
+
+File File::openNextFile(const char * mode){
+    File f;
+    if(!_fs){
+        return f;
+    }
+    std::string dir = (_path.size() && _path.back() == '/') ? _path : _path + "/";
+    size_t i = 0;
+    for(const auto & entry : _fs->files){
+        if(!entry.first.compare(0, dir.size(), dir) && i++ == _next){
+            _next++;
+            f._file = entry.second;
+            f._path = entry.first;
+            return f;
+        }
+    }
+    return f;
+}
+
+void File::rewindDirectory(void){
+    _next = 0;
+}
+
+FS::FS(): _data(new HostFSData()) {}
+
+File FS::open(const char * path, const char * mode, const bool create){
+    File f;
+    std::string p(path ? path : "");
+    auto found = _data->files.find(p);
+    if(mode[0] == 'w' || mode[0] == 'a'){
+        if(found == _data->files.end() || mode[0] == 'w'){
+            std::shared_ptr<HostFileData> file(new HostFileData());
+            file->written = time(NULL);
+            _data->files[p] = file;
+            found = _data->files.find(p);
+        }
+        f._file = found->second;
+        f._writable = true;
+        f._pos = (mode[0] == 'a') ? f._file->content.size() : 0;
+        f._path = p;
+        return f;
+    }
+    if(found != _data->files.end()){
+        f._file = found->second;
+        f._path = p;
+        return f;
+    }
+    //a directory if some file lives below it
+    std::string dir = (p.size() && p.back() == '/') ? p : p + "/";
+    auto below = _data->files.lower_bound(dir);
+    if(below != _data->files.end() && !below->first.compare(0, dir.size(), dir)){
+        f._fs = _data;
+        f._path = p;
+    }
+    return f;
+}
+
+bool FS::exists(const char * path){
+    return (bool)open(path, FILE_READ);
+}
+
+bool FS::remove(const char * path){
+    return _data->files.erase(path) > 0;
+}
+
+bool FS::rename(const char * pathFrom, const char * pathTo){
+    auto found = _data->files.find(pathFrom);
+    if(found == _data->files.end()){
+        return false;
+    }
+    std::shared_ptr<HostFileData> file = found->second;
+    _data->files.erase(found);
+    _data->files[pathTo] = file;
+    return true;
+}
+
+} // namespace fs
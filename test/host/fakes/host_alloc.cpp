@@ -0,0 +1,83 @@
+#include "host_alloc.h"
+#include <stddef.h>
+#include <atomic>
+
+static std::atomic<uint64_t> _allocs(0);
+static std::atomic<uint64_t> _reallocs(0);
+static std::atomic<uint64_t> _frees(0);
+static std::atomic<uint64_t> _bytes(0);
+static thread_local int _quiet = 0;
+
+#ifdef HOST_ALLOC_HOOKS
+
+extern "C" {
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t count, size_t size);
+void * __libc_realloc(void * ptr, size_t size);
+void __libc_free(void * ptr);
+
+void * malloc(size_t size){
+    if(!_quiet){
+        _allocs.fetch_add(1, std::memory_order_relaxed);
+        _bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size){
+    if(!_quiet){
+        _allocs.fetch_add(1, std::memory_order_relaxed);
+        _bytes.fetch_add(count * size, std::memory_order_relaxed);
+    }
+    return __libc_calloc(count, size);
+}
+
+void * realloc(void * ptr, size_t size){
+    if(!_quiet){
+        (ptr ? _reallocs : _allocs).fetch_add(1, std::memory_order_relaxed);
+        _bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    return __libc_realloc(ptr, size);
+}
+
+void free(void * ptr){
+    if(ptr && !_quiet){
+        _frees.fetch_add(1, std::memory_order_relaxed);
+    }
+    __libc_free(ptr);
+}
+}
+
+bool host_alloc_counting(){
+    return true;
+}
+
+#else
+
+bool host_alloc_counting(){
+    return false;
+}
+
+#endif
+
+void host_alloc_get_stats(host_alloc_stats_t * stats){
+    stats->allocs = _allocs.load(std::memory_order_relaxed);
+    stats->reallocs = _reallocs.load(std::memory_order_relaxed);
+    stats->frees = _frees.load(std::memory_order_relaxed);
+    stats->bytes = _bytes.load(std::memory_order_relaxed);
+}
+
+void host_alloc_reset_stats(){
+    _allocs.store(0, std::memory_order_relaxed);
+    _reallocs.store(0, std::memory_order_relaxed);
+    _frees.store(0, std::memory_order_relaxed);
+    _bytes.store(0, std::memory_order_relaxed);
+}
+
+HostAllocQuiet::HostAllocQuiet(){
+    _quiet++;
+}
+
+HostAllocQuiet::~HostAllocQuiet(){
+    _quiet--;
+}
@@ -0,0 +1,35 @@
+/*
+ * Heap accounting for the host build.
+ *
+ * malloc() and friends are wrapped so that every heap call made by the code
+ * under test is counted. The stand-ins (stack, peers, queues) wrap their own
+ * bookkeeping in a HostAllocQuiet scope: the counters show what the libraries
+ * would cost on the device, not what simulating the network costs.
+ * Sanitizer builds leave the allocator alone and count nothing.
+ * */
+
+#ifndef HOST_ALLOC_H_
+#define HOST_ALLOC_H_
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t allocs; //malloc, calloc, realloc of NULL and operator new
+    uint64_t reallocs;
+    uint64_t frees;
+    uint64_t bytes; //requested by allocs and reallocs
+} host_alloc_stats_t;
+
+//false when the allocator hooks are not built in
+bool host_alloc_counting();
+void host_alloc_get_stats(host_alloc_stats_t * stats);
+void host_alloc_reset_stats();
+
+//heap calls made by this thread while it is alive are not counted
+class HostAllocQuiet {
+  public:
+    HostAllocQuiet();
+    ~HostAllocQuiet();
+};
+
+#endif /* HOST_ALLOC_H_ */
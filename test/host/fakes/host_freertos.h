@@ -0,0 +1,9 @@
+#ifndef HOST_FREERTOS_PRIV_H_
+#define HOST_FREERTOS_PRIV_H_
+
+#include "freertos/FreeRTOS.h"
+
+//free slots in the fullest queue that holds more than one item
+UBaseType_t host_queue_min_space();
+
+#endif /* HOST_FREERTOS_PRIV_H_ */
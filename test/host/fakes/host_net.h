@@ -0,0 +1,63 @@
+/*
+ * The remote end of the loopback stack.
+ *
+ * A HostPeer is a client connecting to a pcb listening in the stand-in lwIP.
+ * Its callbacks run on the stack thread with the stack lock held, they may
+ * call back into the peer (send the next request, close...). Everything the
+ * server writes reaches the peer when it is acked, which happens on the next
+ * pass of the stack thread; a buffer released too early shows up as corrupt
+ * data there.
+ * */
+
+#ifndef HOST_NET_H_
+#define HOST_NET_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+struct host_conn;
+
+class HostPeer {
+  public:
+    HostPeer();
+    virtual ~HostPeer();
+
+    //queues the SYN, it is accepted once the listener has a free pcb
+    bool connect(uint16_t port);
+    size_t send(const void * data, size_t len);
+    size_t send(const char * data);
+    //sends a FIN, the server may keep sending
+    void close();
+    //sends a RST
+    void abort();
+    bool connected() const { return _conn != NULL; }
+
+    //the server accepted the connection
+    virtual void onConnect(){}
+    virtual void onData(const uint8_t * data, size_t len){}
+    //the server sent its FIN, all of its data has been delivered before
+    virtual void onFin(){}
+    //the server reset the connection, or there was nothing listening
+    virtual void onReset(){}
+    //both sides are closed, the peer can connect again
+    virtual void onClosed(){}
+
+  private:
+    friend struct host_conn;
+    friend class HostStack;
+    host_conn * _conn;
+};
+
+typedef struct {
+    uint32_t api_calls; //tcpip_api_call() invocations
+    uint32_t accepted; //connections handed to a listener
+    uint32_t resets; //connections reset by the server
+    uint32_t pcb_waits; //SYNs that had to wait for a free pcb
+    uint32_t pcbs_used; //pcbs in use right now
+    uint32_t pcbs_used_max;
+} host_net_stats_t;
+
+void host_net_get_stats(host_net_stats_t * stats);
+void host_net_reset_stats();
+
+#endif /* HOST_NET_H_ */
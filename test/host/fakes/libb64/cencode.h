@@ -0,0 +1,21 @@
+/*
+ * Host stand-in for the libb64 encoder the Arduino core ships
+ * */
+
+#ifndef HOST_BASE64_CENCODE_H_
+#define HOST_BASE64_CENCODE_H_
+
+#define base64_encode_expected_len(n) ((((4 * (n)) / 3) + 3) & ~3)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//encodes without line breaks and terminates the output, returns its length
+int base64_encode_chars(const char * plaintext_in, int length_in, char * code_out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_BASE64_CENCODE_H_ */
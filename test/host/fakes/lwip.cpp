@@ -0,0 +1,808 @@
+/*
+ * Loopback stand-in for lwIP's raw TCP API.
+ *
+ * A stack thread plays the tcpip thread. Every pass it accepts waiting SYNs,
+ * delivers what the peers sent, hands everything that was output to the
+ * peers and acks it, delivers FINs and runs the poll timers. It keeps the
+ * rules of lwIP 2.1 that the libraries depend on:
+ *  - tcp_write() without TCP_WRITE_FLAG_COPY references the data until it is
+ *    acked, the peer reads it only then
+ *  - data sits in the send queue until tcp_output(), an ack or the poll timer
+ *  - tcp_close() resets when received data was not tcp_recved() yet, data
+ *    arriving after tcp_close() resets as well
+ *  - at most MEMP_NUM_TCP_PCB pcbs are active, SYNs wait for one
+ *  - pcb memory is never freed, a stale pointer finds a CLOSED pcb
+ * Callbacks run with the stack lock held, like on the tcpip thread.
+ *
+ * The real tcpip thread blocks when the async task's queue is full. The stack
+ * thread runs far faster than a radio delivers segments, so it only calls into
+ * the pcbs while every event queue has room for what it is about to post.
+ * */
+
+#include "lwip/tcp.h"
+#include "lwip/dns.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "Arduino.h"
+#include "host_net.h"
+#include "host_alloc.h"
+#include "host_freertos.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//events left unclaimed in the queues, for the ones the library posts itself
+#define HOST_QUEUE_HEADROOM 4
+
+struct host_segment {
+    const uint8_t * data;
+    uint16_t len;
+    uint16_t segments;
+    std::unique_ptr<uint8_t[]> copy;
+};
+
+struct host_conn {
+    HostPeer * peer;
+    tcp_pcb * pcb; //NULL once lwIP freed it
+    uint16_t port;
+    bool waited; //counted in pcb_waits already
+    std::deque<host_segment> unsent;
+    std::deque<host_segment> unacked;
+    std::string to_server; //sent by the peer, not delivered yet
+    bool peer_fin; //the peer closed, delivered once to_server is empty
+    bool peer_fin_delivered;
+    bool fin_queued; //the server closed, the FIN follows the queued data
+    bool fin_delivered;
+    bool done;
+    uint32_t polled_at;
+    uint32_t fin_wait_at;
+};
+
+static std::recursive_mutex _core;
+static std::condition_variable_any _wake;
+static bool _work = false;
+static std::once_flag _started;
+
+static std::vector<tcp_pcb *> _free_pcbs;
+static std::vector<tcp_pcb *> _listeners;
+static std::deque<host_conn *> _syns;
+static std::vector<host_conn *> _conns;
+static size_t _next_conn = 0;
+static uint16_t _next_port = 49152;
+
+static std::atomic<uint32_t> _api_calls(0);
+static uint32_t _accepted = 0;
+static uint32_t _resets = 0;
+static uint32_t _pcb_waits = 0;
+static uint32_t _pcbs_used = 0;
+static uint32_t _pcbs_used_max = 0;
+
+static void _start();
+
+//call with _core held
+static void _signal(){
+    _work = true;
+    _wake.notify_one();
+}
+
+/*
+ * Pcbs
+ * */
+
+static tcp_pcb * _pcb_alloc(){
+    if(_pcbs_used >= MEMP_NUM_TCP_PCB){
+        return NULL;
+    }
+    HostAllocQuiet quiet;
+    tcp_pcb * pcb;
+    if(_free_pcbs.empty()){
+        pcb = new tcp_pcb;
+    } else {
+        pcb = _free_pcbs.back();
+        _free_pcbs.pop_back();
+    }
+    memset(pcb, 0, sizeof(tcp_pcb));
+    pcb->allocated = 1;
+    pcb->state = CLOSED;
+    pcb->mss = TCP_MSS;
+    pcb->snd_buf = TCP_SND_BUF;
+    pcb->rcv_wnd = TCP_WND;
+    if(++_pcbs_used > _pcbs_used_max){
+        _pcbs_used_max = _pcbs_used;
+    }
+    return pcb;
+}
+
+static void _pcb_free(tcp_pcb * pcb){
+    if(!pcb->allocated){
+        return;
+    }
+    HostAllocQuiet quiet;
+    host_conn * conn = pcb->conn;
+    if(conn){
+        conn->pcb = NULL;
+        conn->unsent.clear();
+        conn->unacked.clear();
+    }
+    memset(pcb, 0, sizeof(tcp_pcb));
+    pcb->state = CLOSED;
+    _free_pcbs.push_back(pcb);
+    _pcbs_used--;
+}
+
+/*
+ * Connections
+ * */
+
+class HostStack {
+  public:
+    static void detach(HostPeer * peer){ peer->_conn = NULL; }
+    static void accept(int & budget);
+    static void deliver(host_conn * conn, int & budget, uint32_t now);
+    static bool pass();
+    static void run();
+};
+
+//the peer learns about it, the connection is gone for both sides
+static void _conn_finish(host_conn * conn, bool reset){
+    if(conn->done){
+        return;
+    }
+    conn->done = true;
+    if(conn->pcb){
+        _pcb_free(conn->pcb);
+    }
+    HostPeer * peer = conn->peer;
+    conn->peer = NULL;
+    if(peer){
+        HostStack::detach(peer);
+        HostAllocQuiet quiet;
+        if(reset){
+            _resets++;
+            peer->onReset();
+        } else {
+            peer->onClosed();
+        }
+    }
+}
+
+//lwIP's tcp_abandon(): RST to the peer, err callback with ERR_ABRT
+static void _abort(tcp_pcb * pcb, err_t err){
+    host_conn * conn = pcb->conn;
+    tcp_err_fn errf = pcb->errf;
+    void * arg = pcb->callback_arg;
+    _pcb_free(pcb);
+    if(conn){
+        _conn_finish(conn, true);
+    }
+    if(errf){
+        errf(arg, err);
+    }
+}
+
+//moves the send queue to the unacked queue
+static void _output(host_conn * conn){
+    if(conn->unsent.empty()){
+        return;
+    }
+    HostAllocQuiet quiet;
+    while(!conn->unsent.empty()){
+        conn->unacked.push_back(std::move(conn->unsent.front()));
+        conn->unsent.pop_front();
+    }
+    _signal();
+}
+
+//sends the FIN after the queued data, for tcp_close() and tcp_shutdown()
+static void _send_fin(tcp_pcb * pcb){
+    host_conn * conn = pcb->conn;
+    if(pcb->state == ESTABLISHED || pcb->state == SYN_RCVD){
+        pcb->state = FIN_WAIT_1;
+    } else if(pcb->state == CLOSE_WAIT){
+        pcb->state = LAST_ACK;
+    } else {
+        return;
+    }
+    conn->fin_queued = true;
+    _output(conn);
+    _signal();
+}
+
+static err_t _recv_null(void * arg, tcp_pcb * pcb, pbuf * p, err_t err){
+    if(p){
+        tcp_recved(pcb, p->tot_len);
+        pbuf_free(p);
+    } else if(err == ERR_OK){
+        return tcp_close(pcb);
+    }
+    return ERR_OK;
+}
+
+static pbuf * _pbuf_alloc(const char * data, uint16_t len){
+    HostAllocQuiet quiet;
+    pbuf * p = (pbuf *)malloc(sizeof(pbuf) + len);
+    p->next = NULL;
+    p->payload = p + 1;
+    p->tot_len = len;
+    p->len = len;
+    p->type_internal = 0;
+    p->flags = 0;
+    p->ref = 1;
+    memcpy(p->payload, data, len);
+    return p;
+}
+
+/*
+ * Stack Thread
+ * */
+
+void HostStack::accept(int & budget){
+    while(!_syns.empty() && budget > 0){
+        host_conn * conn = _syns.front();
+        if(conn->done){
+            HostAllocQuiet quiet;
+            _syns.pop_front();
+            delete conn;
+            continue;
+        }
+        tcp_pcb * listener = NULL;
+        for(tcp_pcb * l : _listeners){
+            if(l->local_port == conn->port && l->accept){
+                listener = l;
+            }
+        }
+        if(!listener){
+            {
+                HostAllocQuiet quiet;
+                _syns.pop_front();
+                _conns.push_back(conn);
+            }
+            _conn_finish(conn, true);
+            continue;
+        }
+        tcp_pcb * pcb = _pcb_alloc();
+        if(!pcb){
+            if(!conn->waited){
+                conn->waited = true;
+                _pcb_waits++;
+            }
+            return;
+        }
+        {
+            HostAllocQuiet quiet;
+            _syns.pop_front();
+            _conns.push_back(conn);
+        }
+        pcb->state = ESTABLISHED;
+        pcb->conn = conn;
+        pcb->local_ip = listener->local_ip;
+        pcb->local_port = listener->local_port;
+        pcb->remote_ip.type = IPADDR_TYPE_V4;
+        pcb->remote_ip.u_addr.ip4.addr = htonl(IPADDR_LOOPBACK);
+        pcb->remote_port = _next_port++;
+        if(_next_port == 0){
+            _next_port = 49152;
+        }
+        pcb->callback_arg = listener->callback_arg;
+        conn->pcb = pcb;
+        conn->polled_at = millis();
+        _accepted++;
+        budget--;
+        err_t err = listener->accept(listener->callback_arg, pcb, ERR_OK);
+        if(err != ERR_OK && err != ERR_ABRT && conn->pcb == pcb){
+            _abort(pcb, ERR_ABRT);
+        }
+        if(conn->peer && !conn->done){
+            HostAllocQuiet quiet;
+            conn->peer->onConnect();
+        }
+    }
+}
+
+void HostStack::deliver(host_conn * conn, int & budget, uint32_t now){
+    tcp_pcb * pcb = conn->pcb;
+
+    //the peer reads what was output and acks it
+    if(pcb && !conn->unacked.empty()){
+        uint32_t acked = 0;
+        while(!conn->unacked.empty()){
+            host_segment & s = conn->unacked.front();
+            if(conn->peer){
+                HostAllocQuiet quiet;
+                conn->peer->onData(s.data, s.len);
+            }
+            //the peer may have reset the connection
+            if(!conn->pcb){
+                return;
+            }
+            acked += s.len;
+            pcb->snd_buf += s.len;
+            pcb->snd_queuelen -= s.segments;
+            HostAllocQuiet quiet;
+            conn->unacked.pop_front();
+        }
+        while(acked && pcb->sent){
+            uint16_t len = acked > 0xFFFF ? 0xFFFF : acked;
+            acked -= len;
+            budget--;
+            if(pcb->sent(pcb->callback_arg, pcb, len) == ERR_ABRT || conn->pcb != pcb){
+                return;
+            }
+        }
+        //tcp_input() outputs whatever was queued once an ack came in
+        _output(conn);
+    }
+
+    //our FIN, once the data queued before it is through
+    if(pcb && conn->fin_queued && !conn->fin_delivered && conn->unsent.empty() && conn->unacked.empty()){
+        conn->fin_delivered = true;
+        if(conn->peer){
+            HostAllocQuiet quiet;
+            conn->peer->onFin();
+        }
+        if(!conn->pcb){
+            return;
+        }
+        if(pcb->state == FIN_WAIT_1){
+            pcb->state = FIN_WAIT_2;
+            conn->fin_wait_at = now;
+        } else if(pcb->state == CLOSING || pcb->state == LAST_ACK){
+            _pcb_free(pcb);
+            return;
+        }
+    }
+
+    //data from the peer
+    if(!conn->to_server.empty()){
+        if(!pcb || (pcb->flags & TF_RXCLOSED)){
+            //nobody reads it anymore, lwIP answers with a RST
+            if(pcb){
+                _abort(pcb, ERR_ABRT);
+            } else {
+                _conn_finish(conn, true);
+            }
+            return;
+        }
+        while(budget > 0 && pcb->rcv_wnd && !conn->to_server.empty()){
+            size_t len = conn->to_server.size();
+            if(len > pcb->mss){
+                len = pcb->mss;
+            }
+            if(len > pcb->rcv_wnd){
+                len = pcb->rcv_wnd;
+            }
+            pbuf * p = _pbuf_alloc(conn->to_server.data(), len);
+            {
+                HostAllocQuiet quiet;
+                conn->to_server.erase(0, len);
+            }
+            pcb->rcv_wnd -= len;
+            budget--;
+            tcp_recv_fn recv = pcb->recv ? pcb->recv : _recv_null;
+            if(recv(pcb->callback_arg, pcb, p, ERR_OK) == ERR_ABRT || conn->pcb != pcb){
+                return;
+            }
+        }
+    }
+
+    //the peer's FIN
+    if(pcb && conn->peer_fin && !conn->peer_fin_delivered && conn->to_server.empty() && budget > 0){
+        conn->peer_fin_delivered = true;
+        bool closed = false;
+        if(pcb->state == ESTABLISHED){
+            pcb->state = CLOSE_WAIT;
+        } else if(pcb->state == FIN_WAIT_1){
+            pcb->state = CLOSING;
+        } else if(pcb->state == FIN_WAIT_2){
+            pcb->state = TIME_WAIT;
+            closed = true;
+        }
+        if(!(pcb->flags & TF_RXCLOSED)){
+            budget--;
+            tcp_recv_fn recv = pcb->recv ? pcb->recv : _recv_null;
+            if(recv(pcb->callback_arg, pcb, NULL, ERR_OK) == ERR_ABRT || conn->pcb != pcb){
+                return;
+            }
+        }
+        if(closed){
+            _pcb_free(pcb);
+            return;
+        }
+    }
+
+    //tcp_slowtmr(): poll, then output what is still queued
+    if(pcb && pcb->pollinterval && (now - conn->polled_at) >= (uint32_t)pcb->pollinterval * TCP_SLOW_INTERVAL && budget > 0){
+        conn->polled_at = now;
+        if(pcb->poll){
+            budget--;
+            if(pcb->poll(pcb->callback_arg, pcb) == ERR_ABRT || conn->pcb != pcb){
+                return;
+            }
+        }
+        _output(conn);
+    }
+    if(pcb && pcb->state == FIN_WAIT_2 && (pcb->flags & TF_RXCLOSED) && (now - conn->fin_wait_at) >= TCP_FIN_WAIT_TIMEOUT){
+        _pcb_free(pcb);
+    }
+}
+
+//one pass over everything, returns true if there may be more to do right away
+bool HostStack::pass(){
+    int budget = (int)host_queue_min_space() - HOST_QUEUE_HEADROOM;
+    if(budget <= 0){
+        return true;
+    }
+    int full = budget;
+    uint32_t now = millis();
+    accept(budget);
+    size_t count = _conns.size();
+    for(size_t i = 0; i < count && budget > 0; i++){
+        //round robin, a busy connection does not starve the others
+        host_conn * conn = _conns[(_next_conn + i) % count];
+        if(!conn->done){
+            deliver(conn, budget, now);
+        }
+        if(!conn->done && !conn->pcb && conn->peer_fin){
+            _conn_finish(conn, false);
+        }
+    }
+    if(count){
+        _next_conn = (_next_conn + 1) % count;
+    }
+    HostAllocQuiet quiet;
+    for(size_t i = 0; i < _conns.size();){
+        if(_conns[i]->done){
+            delete _conns[i];
+            _conns[i] = _conns.back();
+            _conns.pop_back();
+        } else {
+            i++;
+        }
+    }
+    return budget < full;
+}
+
+void HostStack::run(){
+    std::unique_lock<std::recursive_mutex> lock(_core);
+    for(;;){
+        _work = false;
+        if(pass()){
+            //let the async task and the api calls in
+            lock.unlock();
+            std::this_thread::yield();
+            lock.lock();
+        } else if(!_work){
+            _wake.wait_for(lock, std::chrono::milliseconds(5));
+        }
+    }
+}
+
+static void _start(){
+    std::call_once(_started, []{
+        HostAllocQuiet quiet;
+        std::thread(HostStack::run).detach();
+    });
+}
+
+void host_net_get_stats(host_net_stats_t * stats){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    stats->api_calls = _api_calls.load(std::memory_order_relaxed);
+    stats->accepted = _accepted;
+    stats->resets = _resets;
+    stats->pcb_waits = _pcb_waits;
+    stats->pcbs_used = _pcbs_used;
+    stats->pcbs_used_max = _pcbs_used_max;
+}
+
+void host_net_reset_stats(){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    _api_calls.store(0, std::memory_order_relaxed);
+    _accepted = 0;
+    _resets = 0;
+    _pcb_waits = 0;
+    _pcbs_used_max = _pcbs_used;
+}
+
+/*
+ * Peers
+ * */
+
+HostPeer::HostPeer()
+: _conn(NULL)
+{}
+
+HostPeer::~HostPeer(){
+    abort();
+}
+
+bool HostPeer::connect(uint16_t port){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    if(_conn){
+        return false;
+    }
+    _start();
+    HostAllocQuiet quiet;
+    _conn = new host_conn();
+    _conn->peer = this;
+    _conn->port = port;
+    _syns.push_back(_conn);
+    _signal();
+    return true;
+}
+
+size_t HostPeer::send(const void * data, size_t len){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    if(!_conn || _conn->peer_fin){
+        return 0;
+    }
+    HostAllocQuiet quiet;
+    _conn->to_server.append((const char *)data, len);
+    _signal();
+    return len;
+}
+
+size_t HostPeer::send(const char * data){
+    return send(data, strlen(data));
+}
+
+void HostPeer::close(){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    if(!_conn){
+        return;
+    }
+    _conn->peer_fin = true;
+    _signal();
+}
+
+void HostPeer::abort(){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    host_conn * conn = _conn;
+    if(!conn){
+        return;
+    }
+    _conn = NULL;
+    conn->peer = NULL;
+    if(conn->pcb){
+        tcp_pcb * pcb = conn->pcb;
+        tcp_err_fn errf = pcb->errf;
+        void * arg = pcb->callback_arg;
+        _pcb_free(pcb);
+        conn->done = true;
+        if(errf){
+            errf(arg, ERR_RST);
+        }
+    } else {
+        conn->done = true;
+    }
+    _signal();
+}
+
+/*
+ * lwIP API
+ * */
+
+extern "C" {
+
+err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data * call){
+    _api_calls.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    return fn(call);
+}
+
+struct tcp_pcb * tcp_new(void){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    _start();
+    return _pcb_alloc();
+}
+
+struct tcp_pcb * tcp_new_ip_type(uint8_t type){
+    return tcp_new();
+}
+
+void tcp_arg(struct tcp_pcb * pcb, void * arg){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    pcb->callback_arg = arg;
+}
+
+void tcp_accept(struct tcp_pcb * pcb, tcp_accept_fn accept){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    pcb->accept = accept;
+    _signal();
+}
+
+void tcp_recv(struct tcp_pcb * pcb, tcp_recv_fn recv){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    pcb->recv = recv;
+}
+
+void tcp_sent(struct tcp_pcb * pcb, tcp_sent_fn sent){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    pcb->sent = sent;
+}
+
+void tcp_poll(struct tcp_pcb * pcb, tcp_poll_fn poll, uint8_t interval){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    pcb->poll = poll;
+    pcb->pollinterval = interval;
+}
+
+void tcp_err(struct tcp_pcb * pcb, tcp_err_fn err){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    pcb->errf = err;
+}
+
+err_t tcp_bind(struct tcp_pcb * pcb, const ip_addr_t * ipaddr, uint16_t port){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    for(tcp_pcb * l : _listeners){
+        if(l->local_port == port){
+            return ERR_USE;
+        }
+    }
+    if(ipaddr){
+        pcb->local_ip = *ipaddr;
+    }
+    pcb->local_port = port;
+    return ERR_OK;
+}
+
+struct tcp_pcb * tcp_listen_with_backlog(struct tcp_pcb * pcb, uint8_t backlog){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    tcp_pcb * listener;
+    {
+        HostAllocQuiet quiet;
+        listener = new tcp_pcb;
+        memset(listener, 0, sizeof(tcp_pcb));
+        _listeners.push_back(listener);
+    }
+    listener->state = LISTEN;
+    listener->local_ip = pcb->local_ip;
+    listener->local_port = pcb->local_port;
+    listener->callback_arg = pcb->callback_arg;
+    _pcb_free(pcb);
+    return listener;
+}
+
+err_t tcp_connect(struct tcp_pcb * pcb, const ip_addr_t * ipaddr, uint16_t port, tcp_connected_fn connected){
+    //outgoing connections are not modelled
+    return ERR_RTE;
+}
+
+err_t tcp_write(struct tcp_pcb * pcb, const void * dataptr, uint16_t len, uint8_t apiflags){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    if(!pcb->conn || (pcb->state != ESTABLISHED && pcb->state != CLOSE_WAIT)){
+        return ERR_CONN;
+    }
+    if(len == 0){
+        return ERR_OK;
+    }
+    uint16_t segments = (len + pcb->mss - 1) / pcb->mss;
+    if(len > pcb->snd_buf || pcb->snd_queuelen + segments > TCP_SND_QUEUELEN){
+        return ERR_MEM;
+    }
+    HostAllocQuiet quiet;
+    host_segment s;
+    s.len = len;
+    s.segments = segments;
+    if(apiflags & TCP_WRITE_FLAG_COPY){
+        s.copy.reset(new uint8_t[len]);
+        memcpy(s.copy.get(), dataptr, len);
+        s.data = s.copy.get();
+    } else {
+        s.data = (const uint8_t *)dataptr;
+    }
+    pcb->conn->unsent.push_back(std::move(s));
+    pcb->snd_buf -= len;
+    pcb->snd_queuelen += segments;
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb * pcb){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    if(pcb->conn){
+        _output(pcb->conn);
+    }
+    return ERR_OK;
+}
+
+void tcp_recved(struct tcp_pcb * pcb, uint16_t len){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    uint32_t wnd = (uint32_t)pcb->rcv_wnd + len;
+    pcb->rcv_wnd = wnd > TCP_WND ? TCP_WND : wnd;
+    _signal();
+}
+
+err_t tcp_close(struct tcp_pcb * pcb){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    if(pcb->state == LISTEN){
+        HostAllocQuiet quiet;
+        for(size_t i = 0; i < _listeners.size(); i++){
+            if(_listeners[i] == pcb){
+                _listeners.erase(_listeners.begin() + i);
+                break;
+            }
+        }
+        delete pcb;
+        return ERR_OK;
+    }
+    if(!pcb->conn){
+        _pcb_free(pcb);
+        return ERR_OK;
+    }
+    pcb->flags |= TF_RXCLOSED;
+    if((pcb->state == ESTABLISHED || pcb->state == CLOSE_WAIT) && pcb->rcv_wnd != TCP_WND){
+        //received data the application never took, tcp_close_shutdown() resets
+        host_conn * conn = pcb->conn;
+        _pcb_free(pcb);
+        _conn_finish(conn, true);
+        return ERR_OK;
+    }
+    _send_fin(pcb);
+    return ERR_OK;
+}
+
+err_t tcp_shutdown(struct tcp_pcb * pcb, int shut_rx, int shut_tx){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    if(pcb->state == LISTEN){
+        return ERR_CONN;
+    }
+    if(shut_rx){
+        pcb->flags |= TF_RXCLOSED;
+        if(shut_tx){
+            return tcp_close(pcb);
+        }
+    }
+    if(shut_tx && pcb->conn){
+        _send_fin(pcb);
+    }
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb * pcb){
+    std::lock_guard<std::recursive_mutex> lock(_core);
+    if(pcb->state == LISTEN){
+        tcp_close(pcb);
+        return;
+    }
+    _abort(pcb, ERR_ABRT);
+}
+
+uint8_t pbuf_free(struct pbuf * p){
+    HostAllocQuiet quiet;
+    uint8_t freed = 0;
+    while(p && --p->ref == 0){
+        pbuf * next = p->next;
+        free(p);
+        freed++;
+        p = next;
+    }
+    return freed;
+}
+
+void pbuf_ref(struct pbuf * p){
+    p->ref++;
+}
+
+err_t dns_gethostbyname(const char * hostname, ip_addr_t * addr, dns_found_callback found, void * arg){
+    struct in_addr parsed;
+    if(inet_pton(AF_INET, hostname, &parsed) != 1){
+        return ERR_ARG;
+    }
+    addr->type = IPADDR_TYPE_V4;
+    addr->u_addr.ip4.addr = parsed.s_addr;
+    return ERR_OK;
+}
+
+const char * ipaddr_ntoa(const ip_addr_t * addr){
+    static thread_local char buf[INET_ADDRSTRLEN];
+    struct in_addr a;
+    a.s_addr = addr->u_addr.ip4.addr;
+    return inet_ntop(AF_INET, &a, buf, sizeof(buf));
+}
+
+}
@@ -0,0 +1,19 @@
+#ifndef HOST_LWIP_DNS_H_
+#define HOST_LWIP_DNS_H_
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*dns_found_callback)(const char * name, const ip_addr_t * ipaddr, void * arg);
+//there is no resolver on the host, only dotted quads are accepted
+err_t dns_gethostbyname(const char * hostname, ip_addr_t * addr, dns_found_callback found, void * arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_DNS_H_ */
@@ -0,0 +1 @@
+#include "lwip/ip_addr.h"
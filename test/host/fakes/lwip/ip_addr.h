@@ -0,0 +1,31 @@
+#ifndef HOST_LWIP_IP_ADDR_H_
+#define HOST_LWIP_IP_ADDR_H_
+
+#include <stdint.h>
+
+typedef struct ip4_addr {
+    uint32_t addr;
+} ip4_addr_t;
+
+typedef struct ip_addr {
+    union {
+        ip4_addr_t ip4;
+    } u_addr;
+    uint8_t type;
+} ip_addr_t;
+
+#define IPADDR_TYPE_V4 0U
+#define IPADDR_ANY ((uint32_t)0x00000000UL)
+#define IPADDR_LOOPBACK ((uint32_t)0x7f000001UL)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const char * ipaddr_ntoa(const ip_addr_t * addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_IP_ADDR_H_ */
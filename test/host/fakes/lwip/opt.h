@@ -0,0 +1,18 @@
+/*
+ * Host stand-in for lwIP: the options the IDF build uses for the ESP32
+ * */
+
+#ifndef HOST_LWIP_OPT_H_
+#define HOST_LWIP_OPT_H_
+
+#include "sdkconfig.h"
+
+#define TCP_MSS 1436
+#define TCP_SND_BUF (4 * TCP_MSS)
+#define TCP_WND (4 * TCP_MSS)
+#define TCP_SND_QUEUELEN ((4 * (TCP_SND_BUF) + (TCP_MSS - 1)) / (TCP_MSS))
+#define MEMP_NUM_TCP_PCB CONFIG_LWIP_MAX_ACTIVE_TCP
+#define TCP_SLOW_INTERVAL 500
+#define TCP_FIN_WAIT_TIMEOUT 20000
+
+#endif /* HOST_LWIP_OPT_H_ */
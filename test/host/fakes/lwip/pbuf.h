@@ -0,0 +1,28 @@
+#ifndef HOST_LWIP_PBUF_H_
+#define HOST_LWIP_PBUF_H_
+
+#include <stdint.h>
+#include "lwip/opt.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct pbuf {
+    struct pbuf * next;
+    void * payload;
+    uint16_t tot_len;
+    uint16_t len;
+    uint8_t type_internal;
+    uint8_t flags;
+    uint16_t ref;
+};
+
+uint8_t pbuf_free(struct pbuf * p);
+void pbuf_ref(struct pbuf * p);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_PBUF_H_ */
@@ -0,0 +1,22 @@
+#ifndef HOST_LWIP_TCPIP_PRIV_H_
+#define HOST_LWIP_TCPIP_PRIV_H_
+
+#include "lwip/err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct tcpip_api_call_data {
+    err_t err;
+};
+
+typedef err_t (*tcpip_api_call_fn)(struct tcpip_api_call_data * call);
+//runs fn with the stack lock held, the host has no separate tcpip thread to post to
+err_t tcpip_api_call(tcpip_api_call_fn fn, struct tcpip_api_call_data * call);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_TCPIP_PRIV_H_ */
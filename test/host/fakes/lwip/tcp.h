@@ -0,0 +1,104 @@
+/*
+ * Host stand-in for the raw lwIP TCP API.
+ * Only the server side is modelled: connections come from HostPeer objects
+ * (see host_net.h) and a stack thread plays the tcpip thread, delivering data,
+ * acks, FINs and polls to the pcbs' callbacks.
+ * */
+
+#ifndef HOST_LWIP_TCP_H_
+#define HOST_LWIP_TCP_H_
+
+#include <stdint.h>
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+enum tcp_state {
+    CLOSED = 0,
+    LISTEN = 1,
+    SYN_SENT = 2,
+    SYN_RCVD = 3,
+    ESTABLISHED = 4,
+    FIN_WAIT_1 = 5,
+    FIN_WAIT_2 = 6,
+    CLOSE_WAIT = 7,
+    CLOSING = 8,
+    LAST_ACK = 9,
+    TIME_WAIT = 10
+};
+
+struct tcp_pcb;
+struct host_conn;
+
+typedef err_t (*tcp_accept_fn)(void * arg, struct tcp_pcb * newpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void * arg, struct tcp_pcb * tpcb, struct pbuf * p, err_t err);
+typedef err_t (*tcp_sent_fn)(void * arg, struct tcp_pcb * tpcb, uint16_t len);
+typedef err_t (*tcp_poll_fn)(void * arg, struct tcp_pcb * tpcb);
+typedef void (*tcp_err_fn)(void * arg, err_t err);
+typedef err_t (*tcp_connected_fn)(void * arg, struct tcp_pcb * tpcb, err_t err);
+
+#define TF_NODELAY 0x40U
+#define TF_RXCLOSED 0x10U
+
+struct tcp_pcb {
+    ip_addr_t local_ip;
+    ip_addr_t remote_ip;
+    uint16_t local_port;
+    uint16_t remote_port;
+    enum tcp_state state;
+    uint16_t mss;
+    uint16_t snd_buf;
+    uint16_t snd_queuelen;
+    uint16_t rcv_wnd;
+    uint8_t flags;
+    uint8_t pollinterval;
+    uint8_t polltmr;
+    void * callback_arg;
+    tcp_accept_fn accept;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_poll_fn poll;
+    tcp_err_fn errf;
+    struct host_conn * conn; //NULL for listening pcbs and free ones
+    uint8_t allocated; //taken from the pool, a stale pointer finds 0
+};
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+#define tcp_sndbuf(pcb) ((pcb)->snd_buf)
+#define tcp_sndqueuelen(pcb) ((pcb)->snd_queuelen)
+#define tcp_mss(pcb) ((pcb)->mss)
+#define tcp_nagle_disable(pcb) ((pcb)->flags |= TF_NODELAY)
+#define tcp_nagle_enable(pcb) ((pcb)->flags &= (uint8_t)~TF_NODELAY)
+#define tcp_nagle_disabled(pcb) (((pcb)->flags & TF_NODELAY) != 0)
+
+struct tcp_pcb * tcp_new(void);
+struct tcp_pcb * tcp_new_ip_type(uint8_t type);
+void tcp_arg(struct tcp_pcb * pcb, void * arg);
+void tcp_accept(struct tcp_pcb * pcb, tcp_accept_fn accept);
+void tcp_recv(struct tcp_pcb * pcb, tcp_recv_fn recv);
+void tcp_sent(struct tcp_pcb * pcb, tcp_sent_fn sent);
+void tcp_poll(struct tcp_pcb * pcb, tcp_poll_fn poll, uint8_t interval);
+void tcp_err(struct tcp_pcb * pcb, tcp_err_fn err);
+err_t tcp_bind(struct tcp_pcb * pcb, const ip_addr_t * ipaddr, uint16_t port);
+struct tcp_pcb * tcp_listen_with_backlog(struct tcp_pcb * pcb, uint8_t backlog);
+#define tcp_listen(pcb) tcp_listen_with_backlog(pcb, 0xFF)
+err_t tcp_connect(struct tcp_pcb * pcb, const ip_addr_t * ipaddr, uint16_t port, tcp_connected_fn connected);
+err_t tcp_write(struct tcp_pcb * pcb, const void * dataptr, uint16_t len, uint8_t apiflags);
+err_t tcp_output(struct tcp_pcb * pcb);
+void tcp_recved(struct tcp_pcb * pcb, uint16_t len);
+err_t tcp_close(struct tcp_pcb * pcb);
+err_t tcp_shutdown(struct tcp_pcb * pcb, int shut_rx, int shut_tx);
+void tcp_abort(struct tcp_pcb * pcb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_LWIP_TCP_H_ */
@@ -0,0 +1,32 @@
+/*
+ * Host stand-in for the mbedTLS MD5 the ESP32 core uses for digest
+ * authentication
+ * */
+
+#ifndef HOST_MBEDTLS_MD5_H_
+#define HOST_MBEDTLS_MD5_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t total[2];
+    uint32_t state[4];
+    unsigned char buffer[64];
+} mbedtls_md5_context;
+
+void mbedtls_md5_init(mbedtls_md5_context * ctx);
+void mbedtls_md5_free(mbedtls_md5_context * ctx);
+int mbedtls_md5_starts(mbedtls_md5_context * ctx);
+int mbedtls_md5_update(mbedtls_md5_context * ctx, const unsigned char * input, size_t ilen);
+int mbedtls_md5_finish(mbedtls_md5_context * ctx, unsigned char output[16]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_MBEDTLS_MD5_H_ */
@@ -0,0 +1,117 @@
+//MD5 as in RFC 1321, behind the mbedTLS interface
+#include "mbedtls/md5.h"
+#include <string.h>
+
+static const uint32_t _k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const uint8_t _r[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static void _process(mbedtls_md5_context * ctx, const unsigned char block[64]){
+    uint32_t w[16];
+    for(int i = 0; i < 16; i++){
+        w[i] = block[i * 4] | (block[i * 4 + 1] << 8) | (block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
+    }
+    uint32_t a = ctx->state[0], b = ctx->state[1], c = ctx->state[2], d = ctx->state[3];
+    for(int i = 0; i < 64; i++){
+        uint32_t f;
+        int g;
+        if(i < 16){
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if(i < 32){
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) % 16;
+        } else if(i < 48){
+            f = b ^ c ^ d;
+            g = (3 * i + 5) % 16;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) % 16;
+        }
+        uint32_t t = d;
+        d = c;
+        c = b;
+        uint32_t x = a + f + _k[i] + w[g];
+        b = b + ((x << _r[i]) | (x >> (32 - _r[i])));
+        a = t;
+    }
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+}
+
+void mbedtls_md5_init(mbedtls_md5_context * ctx){
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+void mbedtls_md5_free(mbedtls_md5_context * ctx){
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+int mbedtls_md5_starts(mbedtls_md5_context * ctx){
+    ctx->total[0] = ctx->total[1] = 0;
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xefcdab89;
+    ctx->state[2] = 0x98badcfe;
+    ctx->state[3] = 0x10325476;
+    return 0;
+}
+
+int mbedtls_md5_update(mbedtls_md5_context * ctx, const unsigned char * input, size_t ilen){
+    size_t fill = ctx->total[0] & 0x3F;
+    ctx->total[0] += (uint32_t)ilen;
+    if(ctx->total[0] < (uint32_t)ilen){
+        ctx->total[1]++;
+    }
+    while(ilen){
+        size_t n = 64 - fill;
+        if(n > ilen){
+            n = ilen;
+        }
+        memcpy(ctx->buffer + fill, input, n);
+        fill += n;
+        input += n;
+        ilen -= n;
+        if(fill == 64){
+            _process(ctx, ctx->buffer);
+            fill = 0;
+        }
+    }
+    return 0;
+}
+
+int mbedtls_md5_finish(mbedtls_md5_context * ctx, unsigned char output[16]){
+    uint32_t high = (ctx->total[0] >> 29) | (ctx->total[1] << 3);
+    uint32_t low = ctx->total[0] << 3;
+    unsigned char length[8];
+    for(int i = 0; i < 4; i++){
+        length[i] = low >> (8 * i);
+        length[i + 4] = high >> (8 * i);
+    }
+    size_t last = ctx->total[0] & 0x3F;
+    size_t pad = (last < 56) ? (56 - last) : (120 - last);
+    static const unsigned char padding[64] = { 0x80 };
+    mbedtls_md5_update(ctx, padding, pad);
+    mbedtls_md5_update(ctx, length, 8);
+    for(int i = 0; i < 4; i++){
+        for(int j = 0; j < 4; j++){
+            output[i * 4 + j] = ctx->state[i] >> (8 * j);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "Print.h"
+#include "Stream.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+size_t Print::write(const uint8_t * buffer, size_t size){
+    size_t n = 0;
+    while(size--){
+        if(!write(*buffer++)){
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+//like the core: a stack buffer first, the heap only for longer output
+size_t Print::printf(const char * format, ...){
+    char loc_buf[64];
+    char * temp = loc_buf;
+    va_list arg;
+    va_list copy;
+    va_start(arg, format);
+    va_copy(copy, arg);
+    int len = vsnprintf(temp, sizeof(loc_buf), format, copy);
+    va_end(copy);
+    if(len < 0){
+        va_end(arg);
+        return 0;
+    }
+    if((size_t)len >= sizeof(loc_buf)){
+        temp = (char *)malloc(len + 1);
+        if(temp == NULL){
+            va_end(arg);
+            return 0;
+        }
+        len = vsnprintf(temp, len + 1, format, arg);
+    }
+    va_end(arg);
+    len = write((uint8_t *)temp, len);
+    if(temp != loc_buf){
+        free(temp);
+    }
+    return len;
+}
+
+size_t Stream::readBytes(char * buffer, size_t length){
+    size_t count = 0;
+    while(count < length){
+        int c = read();
+        if(c < 0){
+            break;
+        }
+        *buffer++ = (char)c;
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,16 @@
+/*
+ * Host stand-in for the IDF generated sdkconfig.h, IDF defaults unless the
+ * build overrides them (e.g. -DCONFIG_LWIP_MAX_ACTIVE_TCP=64)
+ * */
+
+#ifndef HOST_SDKCONFIG_H_
+#define HOST_SDKCONFIG_H_
+
+#ifndef CONFIG_LWIP_MAX_ACTIVE_TCP
+#define CONFIG_LWIP_MAX_ACTIVE_TCP 16
+#endif
+
+#define CONFIG_ASYNC_TCP_RUNNING_CORE -1
+#define CONFIG_ASYNC_TCP_USE_WDT 0
+
+#endif /* HOST_SDKCONFIG_H_ */
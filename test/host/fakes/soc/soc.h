@@ -0,0 +1,9 @@
+/*
+ * Host stand-in for the ESP32 memory map. There is no flash mapped data on
+ * the host, the SOC_DROM_* bounds are left undefined.
+ * */
+
+#ifndef HOST_SOC_H_
+#define HOST_SOC_H_
+
+#endif /* HOST_SOC_H_ */
@@ -0,0 +1,386 @@
+/*
+ * Load generator for AsyncTCP on the host.
+ *
+ * Serves a fixed response from an AsyncServer over the loopback stack and
+ * runs -c peers against it until -n responses have come back. Every peer
+ * opens a connection, sends a browser sized request, reads the response up
+ * to the server's FIN and starts over. The response body is checked byte by
+ * byte, so a buffer released before its ack shows up as an error.
+ *
+ * With -a it fails when the requests cost more heap allocations on average
+ * than given; AsyncTCP itself should not allocate at all once its event packet
+ * and client pools are in place.
+ *
+ * The server sends the head and the body of the response as two buffers, -w
+ * picks how: "add" queues each with add() and flushes with send(), "write"
+ * (the default) queues and flushes each with write(), "cork" writes both
+ * corked and flushes them with uncork(), "writev" hands both to one writev().
+ * Every call into the TCP/IP thread is counted; for a response that fits the
+ * window that is 3, 2, 3 and 1 calls, plus the ones for acking the request
+ * and closing. Corking saves segments, not calls.
+ *
+ * With -m the server takes at most that many clients at once and answers
+ * the connections above it with a 503. Those count as refused, a refused
+ * connection that ends in a reset instead of the 503 counts as an error.
+ *
+ *   loadgen [-c concurrency] [-n requests] [-s response bytes] [-a max allocations per request] [-w add|write|cork|writev] [-m max clients]
+ * */
+
+#include "Arduino.h"
+#include "AsyncTCP.h"
+#include "host_alloc.h"
+#include "host_net.h"
+#include "lwip/opt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#define LOADGEN_PORT 80
+
+static const char * _request =
+    "GET /api/readings HTTP/1.1\r\n"
+    "Host: 192.168.4.1\r\n"
+    "Connection: close\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+    "Accept: application/json, text/plain, */*\r\n"
+    "Accept-Language: en-GB,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Referer: http://192.168.4.1/\r\n"
+    "\r\n";
+
+static const char * _refusal = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+
+static std::vector<char> _response;
+static size_t _response_head;
+
+static uint8_t _body_byte(size_t i){
+    return 'a' + (i * 7 + i / 251) % 26;
+}
+
+static void _build_response(size_t body){
+    char head[128];
+    _response_head = snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\nContent-Length: %u\r\nConnection: close\r\n\r\n", (unsigned)body);
+    _response.assign(head, head + _response_head);
+    for(size_t i = 0; i < body; i++){
+        _response.push_back(_body_byte(i));
+    }
+}
+
+/*
+ * Server
+ * */
+
+//one per client, clients never outnumber the pcbs
+typedef struct {
+    bool used;
+    uint8_t matched; //bytes of the blank line ending the request seen so far
+    size_t sent;
+} server_conn_t;
+
+static server_conn_t _server_conns[CONFIG_LWIP_MAX_ACTIVE_TCP * 2];
+
+typedef enum { WRITE_ADD, WRITE_WRITE, WRITE_CORK, WRITE_WRITEV } write_mode_t;
+static write_mode_t _write_mode = WRITE_WRITE;
+
+static void _server_send(server_conn_t * s, AsyncClient * c){
+    if(_write_mode == WRITE_WRITEV){
+        async_iovec_t iov[2];
+        size_t count = 0;
+        if(s->sent < _response_head){
+            iov[count].data = _response.data() + s->sent;
+            iov[count].len = _response_head - s->sent;
+            iov[count].release = NULL;
+            iov[count].arg = NULL;
+            count++;
+        }
+        size_t body = (s->sent > _response_head) ? s->sent : _response_head;
+        if(body < _response.size()){
+            iov[count].data = _response.data() + body;
+            iov[count].len = _response.size() - body;
+            iov[count].release = NULL;
+            iov[count].arg = NULL;
+            count++;
+        }
+        s->sent += c->writev(iov, count);
+        return;
+    }
+    if(_write_mode == WRITE_CORK){
+        c->cork();
+    }
+    while(s->sent < _response.size() && c->space()){
+        //the head and the body go out as separate writes
+        size_t end = (s->sent < _response_head) ? _response_head : _response.size();
+        //the response is static, lwIP can reference it until it is acked
+        size_t written;
+        if(_write_mode == WRITE_ADD){
+            written = c->add(_response.data() + s->sent, end - s->sent, 0);
+        } else {
+            written = c->write(_response.data() + s->sent, end - s->sent, 0);
+        }
+        if(!written){
+            break;
+        }
+        s->sent += written;
+    }
+    if(_write_mode == WRITE_ADD){
+        c->send();
+    } else if(_write_mode == WRITE_CORK){
+        c->uncork();
+    }
+}
+
+static void _server_data(void * arg, AsyncClient * c, void * data, size_t len){
+    server_conn_t * s = (server_conn_t *)arg;
+    static const char * end = "\r\n\r\n";
+    const char * p = (const char *)data;
+    for(size_t i = 0; i < len && s->matched < 4; i++){
+        s->matched = (p[i] == end[s->matched]) ? s->matched + 1 : (p[i] == '\r' ? 1 : 0);
+    }
+    if(s->matched == 4 && !s->sent){
+        _server_send(s, c);
+    }
+}
+
+static void _server_ack(void * arg, AsyncClient * c, size_t len, uint32_t time){
+    server_conn_t * s = (server_conn_t *)arg;
+    if(c->getAckedBytes() == _response.size()){
+        //closing from onData would reset, the request is not tcp_recved() until it returns
+        c->close();
+    } else if(s->matched == 4){
+        _server_send(s, c);
+    }
+}
+
+static void _server_disconnect(void * arg, AsyncClient * c){
+    server_conn_t * s = (server_conn_t *)arg;
+    s->used = false;
+    delete c;
+}
+
+static void _server_client(void * arg, AsyncClient * c){
+    server_conn_t * s = NULL;
+    for(size_t i = 0; i < sizeof(_server_conns) / sizeof(_server_conns[0]); i++){
+        if(!_server_conns[i].used){
+            s = &_server_conns[i];
+            break;
+        }
+    }
+    if(!s){
+        c->close();
+        delete c;
+        return;
+    }
+    s->used = true;
+    s->matched = 0;
+    s->sent = 0;
+    c->onData(_server_data, s);
+    c->onAck(_server_ack, s);
+    c->onDisconnect(_server_disconnect, s);
+}
+
+/*
+ * Peers
+ * */
+
+static std::mutex _done_lock;
+static std::condition_variable _done_cv;
+static size_t _target = 0;
+static size_t _started = 0;
+static size_t _completed = 0;
+static size_t _refused = 0;
+static size_t _errors = 0;
+static uint64_t _bytes = 0;
+static std::vector<uint32_t> _latencies;
+
+class LoadPeer: public HostPeer {
+  public:
+    LoadPeer(): _received(0), _corrupt(false), _was_refused(false), _started_at(0) {}
+
+    bool next(){
+        {
+            std::lock_guard<std::mutex> lock(_done_lock);
+            if(_started >= _target){
+                return false;
+            }
+            _started++;
+        }
+        _received = 0;
+        _corrupt = false;
+        _was_refused = false;
+        _started_at = micros();
+        return connect(LOADGEN_PORT);
+    }
+
+    void onConnect() override {
+        send(_request);
+    }
+
+    void onData(const uint8_t * data, size_t len) override {
+        if(!_received && len >= 12 && !memcmp(data, _refusal, 12)){
+            _was_refused = true;
+        }
+        if(_was_refused){
+            _corrupt = _corrupt || _received + len > strlen(_refusal) || memcmp(data, _refusal + _received, len);
+            _received += len;
+            return;
+        }
+        for(size_t i = 0; i < len; i++, _received++){
+            if(_received >= _response.size() || (_received >= _response_head && data[i] != _body_byte(_received - _response_head))){
+                _corrupt = true;
+            }
+        }
+    }
+
+    void onFin() override {
+        bool ok = !_corrupt && _received == (_was_refused ? strlen(_refusal) : _response.size());
+        _finished(ok);
+        close();
+    }
+
+    void onReset() override {
+        _finished(false);
+        next();
+    }
+
+    void onClosed() override {
+        next();
+    }
+
+  private:
+    size_t _received;
+    bool _corrupt;
+    bool _was_refused; //the server answered with the 503
+    uint32_t _started_at;
+
+    void _finished(bool ok){
+        std::lock_guard<std::mutex> lock(_done_lock);
+        if(ok && _was_refused){
+            _refused++;
+        } else if(ok){
+            _latencies.push_back(micros() - _started_at);
+            _bytes += _received;
+        } else {
+            _errors++;
+        }
+        if(++_completed == _target){
+            _done_cv.notify_all();
+        }
+    }
+};
+
+static uint32_t _percentile(std::vector<uint32_t> & sorted, double p){
+    if(sorted.empty()){
+        return 0;
+    }
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+int main(int argc, char ** argv){
+    size_t concurrency = 1000;
+    size_t requests = 20000;
+    size_t body = 2048;
+    double max_allocs = -1;
+    uint16_t max_clients = 0;
+    int opt;
+    while((opt = getopt(argc, argv, "c:n:s:a:w:m:")) != -1){
+        switch(opt){
+            case 'c': concurrency = strtoul(optarg, NULL, 0); break;
+            case 'n': requests = strtoul(optarg, NULL, 0); break;
+            case 's': body = strtoul(optarg, NULL, 0); break;
+            case 'a': max_allocs = strtod(optarg, NULL); break;
+            case 'm': max_clients = strtoul(optarg, NULL, 0); break;
+            case 'w':
+                if(!strcmp(optarg, "add")){
+                    _write_mode = WRITE_ADD;
+                    break;
+                } else if(!strcmp(optarg, "write")){
+                    _write_mode = WRITE_WRITE;
+                    break;
+                } else if(!strcmp(optarg, "cork")){
+                    _write_mode = WRITE_CORK;
+                    break;
+                } else if(!strcmp(optarg, "writev")){
+                    _write_mode = WRITE_WRITEV;
+                    break;
+                }
+                //fall through
+            default:
+                fprintf(stderr, "usage: %s [-c concurrency] [-n requests] [-s response bytes] [-a max allocations per request] [-w add|write|cork|writev] [-m max clients]\n", argv[0]);
+                return 2;
+        }
+    }
+    if(concurrency > requests){
+        concurrency = requests;
+    }
+    _build_response(body);
+    _latencies.reserve(requests);
+    _target = requests;
+    std::vector<LoadPeer> peers(concurrency);
+
+    AsyncServer server(LOADGEN_PORT);
+    server.onClient(_server_client, NULL);
+    server.setMaxClients(max_clients);
+    server.setRefusal(_refusal);
+    server.begin();
+
+    host_alloc_reset_stats();
+    host_net_reset_stats();
+    async_tcp_reset_stats();
+    uint32_t event_misses = async_tcp_event_pool_misses();
+    uint32_t client_misses = async_tcp_client_pool_misses();
+    auto started = std::chrono::steady_clock::now();
+    {
+        HostAllocQuiet quiet;
+        for(LoadPeer & peer : peers){
+            peer.next();
+        }
+    }
+    {
+        std::unique_lock<std::mutex> lock(_done_lock);
+        _done_cv.wait(lock, []{ return _completed >= _target; });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    host_alloc_stats_t allocs;
+    host_alloc_get_stats(&allocs);
+    host_net_stats_t net;
+    host_net_get_stats(&net);
+    async_tcp_stats_t tcp;
+    async_tcp_get_stats(&tcp);
+    uint32_t events = 0;
+    for(int i = 0; i < ASYNC_TCP_EVENT_TYPES; i++){
+        events += tcp.events[i];
+    }
+    std::sort(_latencies.begin(), _latencies.end());
+
+    printf("requests     %zu in %.2fs with %zu connections, %.0f req/s, %.2f MB/s\n", requests, seconds, concurrency, requests / seconds, _bytes / seconds / 1e6);
+    printf("latency      p50 %.2fms, p99 %.2fms, max %.2fms\n", _percentile(_latencies, 0.5) / 1e3, _percentile(_latencies, 0.99) / 1e3, _percentile(_latencies, 1) / 1e3);
+    if(host_alloc_counting()){
+        printf("allocations  %llu (%.2f per request), %llu reallocs, %llu frees, %llu bytes\n", (unsigned long long)allocs.allocs, (double)allocs.allocs / requests,
+            (unsigned long long)allocs.reallocs, (unsigned long long)allocs.frees, (unsigned long long)allocs.bytes);
+    } else {
+        printf("allocations  not counted in this build\n");
+    }
+    //each event used to be a malloc() on the tcpip thread and a free() on the async task
+    printf("events       %.2f per request, %u event and %u client pool misses\n", (double)events / requests,
+        tcp.event_pool_misses - event_misses, tcp.client_pool_misses - client_misses);
+    printf("tcpip calls  %.2f per request\n", (double)net.api_calls / requests);
+    printf("pcbs         %u of %u in use at most, %u connections waited for one\n", net.pcbs_used_max, (unsigned)MEMP_NUM_TCP_PCB, net.pcb_waits);
+    if(max_clients){
+        printf("refused      %zu with more than %u clients\n", _refused, (unsigned)max_clients);
+    }
+    printf("errors       %zu (%u resets)\n", _errors, net.resets);
+    //the async task and the stack thread never return
+    bool too_many = host_alloc_counting() && max_allocs >= 0 && (double)allocs.allocs / requests > max_allocs;
+    if(too_many){
+        printf("more than %.2f allocations per request\n", max_allocs);
+    }
+    fflush(stdout);
+    _Exit((_errors || too_many) ? 1 : 0);
+}
@@ -0,0 +1,815 @@
+/*
+ * Benchmarks for AsyncWebServer on the host.
+ *
+ * Runs an AsyncWebServer over the loopback stack and -c peers against it,
+ * each on a persistent connection sending one request after the other, the
+ * way a browser does. A benchmark is made of phases, each phase sends -n
+ * requests taken in turn from its list and checks every response (status,
+ * Content-Length or chunked framing, body). Per phase it prints:
+ *
+ *   req/s      requests per wall clock second, peers and stack included
+ *   MB/s       request bytes sent per wall clock second
+ *   us/req     time the async task spent in the server's handlers (parsing,
+ *              routing, the handler, building and sending the response),
+ *              from AsyncTCP's event timings; the figure to compare
+ *   allocs/req heap calls made by the server and AsyncTCP
+ *   calls/req  calls into the TCP/IP thread
+ *
+ * headers    parse cost per request over requests recorded from browsers,
+ *            one phase per trace, against a handler that sends two bytes
+ * multipart  form uploads the way browsers send them: text fields only, then
+ *            a file part of growing size next to them; the handler checks
+ *            every byte it is given. Fewer requests for the larger files, the
+ *            MB/s the server parses is printed under each phase
+ * routes     routing with 4 up to 256 handlers, exact and prefix urls with
+ *            long common prefixes, each answering with its number; requests
+ *            go to every route in turn plus one that matches none
+ * template   a dashboard with 240 placeholders: from flash through send_P(),
+ *            from a file expanded while streaming (template cache off) and
+ *            from a file compiled once (template cache on)
+ * framing    a generated body several times TCP_SND_BUF, sent with a
+ *            Content-Length, chunked, and with neither (read to the FIN)
+ *
+ *   webbench headers|multipart|routes|template|framing [-c connections] [-n requests per phase]
+ * */
+
+#include "Arduino.h"
+#include "AsyncTCP.h"
+#include "ESPAsyncWebServer.h"
+#include "FS.h"
+#include "WebTemplate.h"
+#include "host_alloc.h"
+#include "host_net.h"
+#include "lwip/opt.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <strings.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define WEBBENCH_PORT 80
+
+//the response to the request at index, false fails it
+typedef std::function<bool(size_t index, int status, const std::string & body)> response_check_t;
+
+typedef struct {
+    const char * name;
+    std::vector<std::string> requests;
+    response_check_t check;
+} phase_t;
+
+static AsyncWebServer _server(WEBBENCH_PORT);
+
+/*
+ * Peers
+ * */
+
+static std::mutex _done_lock;
+static std::condition_variable _done_cv;
+static const phase_t * _phase = NULL;
+static size_t _target = 0;
+static size_t _started = 0;
+static size_t _completed = 0;
+static size_t _idle = 0;
+static size_t _errors = 0;
+static uint64_t _bytes = 0;
+static std::vector<uint32_t> _latencies;
+
+class WebPeer: public HostPeer {
+  public:
+    WebPeer(): _active(false), _index(0), _state(RESPONSE_HEAD), _remaining(0), _status(0), _closes(false), _started_at(0) {}
+
+    //takes the first request of the phase, main thread
+    void begin(){
+        if(_take()){
+            connect(WEBBENCH_PORT);
+        } else {
+            _stop();
+        }
+    }
+
+    void onConnect() override {
+        _send();
+    }
+
+    void onData(const uint8_t * data, size_t len) override {
+        size_t used = 0;
+        while(used < len && _active && _state != RESPONSE_DONE){
+            used += _parse(data + used, len - used);
+        }
+        if(used < len){
+            //more than the response, or a response nobody asked for
+            if(_active){
+                _finished(false);
+            }
+            abort();
+            return;
+        }
+        if(_state != RESPONSE_DONE){
+            return;
+        }
+        _finished(_phase->check(_index, _status, _body));
+        if(_closes){
+            //the server closes, the next request goes on a new connection
+            return;
+        }
+        if(_take()){
+            _send();
+        } else {
+            close();
+        }
+    }
+
+    void onFin() override {
+        if(_active){
+            _finished(_state == RESPONSE_TO_CLOSE && _phase->check(_index, _status, _body));
+        }
+        close();
+    }
+
+    void onReset() override {
+        if(_active){
+            _finished(false);
+        }
+        _reconnect();
+    }
+
+    void onClosed() override {
+        _reconnect();
+    }
+
+  private:
+    typedef enum { RESPONSE_HEAD, RESPONSE_BODY, RESPONSE_TO_CLOSE, RESPONSE_CHUNK_SIZE, RESPONSE_CHUNK_DATA, RESPONSE_CHUNK_END, RESPONSE_TRAILER, RESPONSE_DONE } response_state_t;
+
+    bool _active; //a request of the phase is assigned and not answered yet
+    size_t _index;
+    response_state_t _state;
+    std::string _head;
+    std::string _line;
+    std::string _body;
+    size_t _remaining;
+    int _status;
+    bool _closes;
+    uint32_t _started_at;
+
+    bool _take(){
+        std::lock_guard<std::mutex> lock(_done_lock);
+        if(_started >= _target){
+            return false;
+        }
+        _index = _started++ % _phase->requests.size();
+        _active = true;
+        return true;
+    }
+
+    void _send(){
+        const std::string & request = _phase->requests[_index];
+        _state = RESPONSE_HEAD;
+        _head.clear();
+        _line.clear();
+        _body.clear();
+        _remaining = 0;
+        _status = 0;
+        _closes = false;
+        _started_at = micros();
+        send(request.data(), request.size());
+    }
+
+    void _reconnect(){
+        if(_active || _take()){
+            connect(WEBBENCH_PORT);
+        } else {
+            _stop();
+        }
+    }
+
+    void _stop(){
+        std::lock_guard<std::mutex> lock(_done_lock);
+        _idle++;
+        _done_cv.notify_all();
+    }
+
+    void _finished(bool ok){
+        _active = false;
+        std::lock_guard<std::mutex> lock(_done_lock);
+        if(ok){
+            _latencies.push_back(micros() - _started_at);
+            _bytes += _phase->requests[_index].size();
+        } else {
+            _errors++;
+        }
+        _completed++;
+        _done_cv.notify_all();
+    }
+
+    //the framing of the head, a response without either is read to the FIN
+    void _parseHead(){
+        std::string head(_head);
+        std::transform(head.begin(), head.end(), head.begin(), ::tolower);
+        _status = (head.compare(0, 9, "http/1.1 ") && head.compare(0, 9, "http/1.0 ")) ? 0 : atoi(head.c_str() + 9);
+        _closes = head.find("\r\nconnection: close\r\n") != std::string::npos;
+        size_t length = head.find("\r\ncontent-length:");
+        if(head.find("\r\ntransfer-encoding: chunked\r\n") != std::string::npos){
+            _state = RESPONSE_CHUNK_SIZE;
+        } else if(length != std::string::npos){
+            _remaining = strtoul(head.c_str() + length + 17, NULL, 10);
+            _state = _remaining ? RESPONSE_BODY : RESPONSE_DONE;
+        } else {
+            _closes = true;
+            _state = RESPONSE_TO_CLOSE;
+        }
+    }
+
+    //consumes up to len bytes, returns how many
+    size_t _parse(const uint8_t * data, size_t len){
+        switch(_state){
+            case RESPONSE_HEAD:
+                _head.push_back(data[0]);
+                if(_head.size() >= 4 && !_head.compare(_head.size() - 4, 4, "\r\n\r\n")){
+                    _parseHead();
+                }
+                return 1;
+            case RESPONSE_BODY:
+            case RESPONSE_CHUNK_DATA: {
+                size_t n = std::min(len, _remaining);
+                _body.append((const char *)data, n);
+                _remaining -= n;
+                if(!_remaining){
+                    _state = (_state == RESPONSE_BODY) ? RESPONSE_DONE : RESPONSE_CHUNK_END;
+                }
+                return n;
+            }
+            case RESPONSE_TO_CLOSE:
+                _body.append((const char *)data, len);
+                return len;
+            case RESPONSE_CHUNK_END:
+            case RESPONSE_CHUNK_SIZE:
+            case RESPONSE_TRAILER:
+                _line.push_back(data[0]);
+                if(_line.back() != '\n'){
+                    return 1;
+                }
+                if(_state == RESPONSE_CHUNK_END){
+                    //the CRLF after the data
+                    _state = RESPONSE_CHUNK_SIZE;
+                } else if(_state == RESPONSE_CHUNK_SIZE){
+                    _remaining = strtoul(_line.c_str(), NULL, 16);
+                    _state = _remaining ? RESPONSE_CHUNK_DATA : RESPONSE_TRAILER;
+                } else if(_line == "\r\n"){
+                    _state = RESPONSE_DONE;
+                }
+                _line.clear();
+                return 1;
+            default:
+                return len;
+        }
+    }
+};
+
+/*
+ * Phases
+ * */
+
+static uint32_t _percentile(std::vector<uint32_t> & sorted, double p){
+    if(sorted.empty()){
+        return 0;
+    }
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[i];
+}
+
+//returns the microseconds the async task spent on the phase
+static uint64_t _run(const phase_t & phase, size_t concurrency, size_t requests){
+    {
+        std::lock_guard<std::mutex> lock(_done_lock);
+        _phase = &phase;
+        _target = requests;
+        _started = 0;
+        _completed = 0;
+        _idle = 0;
+        _bytes = 0;
+        _latencies.clear();
+    }
+    //a new set per phase, the last one may still be returning from its callbacks
+    std::vector<WebPeer> * peers;
+    {
+        HostAllocQuiet quiet;
+        peers = new std::vector<WebPeer>(concurrency);
+        _latencies.reserve(requests);
+    }
+    size_t errors = _errors;
+
+    host_alloc_reset_stats();
+    host_net_reset_stats();
+    async_tcp_reset_stats();
+    auto started = std::chrono::steady_clock::now();
+    {
+        HostAllocQuiet quiet;
+        for(WebPeer & peer : *peers){
+            peer.begin();
+        }
+    }
+    {
+        //every peer closes its connection once the phase has no requests left
+        std::unique_lock<std::mutex> lock(_done_lock);
+        _done_cv.wait(lock, [concurrency]{ return _completed >= _target && _idle >= concurrency; });
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+    host_alloc_stats_t allocs;
+    host_alloc_get_stats(&allocs);
+    host_net_stats_t net;
+    host_net_get_stats(&net);
+    async_tcp_stats_t tcp;
+    async_tcp_get_stats(&tcp);
+    std::sort(_latencies.begin(), _latencies.end());
+
+    printf("%-14s %8.0f %8.2f %8.2f", phase.name, requests / seconds, _bytes / seconds / 1e6, (double)tcp.event_time.sum / requests);
+    if(host_alloc_counting()){
+        printf(" %10.2f", (double)allocs.allocs / requests);
+    } else {
+        printf(" %10s", "-");
+    }
+    printf(" %9.2f %7.2fms %7zu\n", (double)net.api_calls / requests, _percentile(_latencies, 0.99) / 1e3, _errors - errors);
+    fflush(stdout);
+    return tcp.event_time.sum;
+}
+
+static void _header(){
+    printf("%-14s %8s %8s %8s %10s %9s %9s %7s\n", "phase", "req/s", "MB/s", "us/req", "allocs/req", "calls/req", "p99", "errors");
+}
+
+/*
+ * Request header parsing
+ * */
+
+typedef struct {
+    const char * name;
+    const char * request;
+} trace_t;
+
+//recorded against the board, Connection: keep-alive is what HTTP/1.1 does anyway
+static const trace_t _traces[] = {
+    { "minimal",
+        "GET / HTTP/1.1\r\n"
+        "Host: 192.168.4.1\r\n"
+        "\r\n" },
+    { "curl",
+        "GET /api/readings HTTP/1.1\r\n"
+        "Host: 192.168.4.1\r\n"
+        "User-Agent: curl/8.5.0\r\n"
+        "Accept: */*\r\n"
+        "\r\n" },
+    { "chrome-page",
+        "GET / HTTP/1.1\r\n"
+        "Host: 192.168.4.1\r\n"
+        "Connection: keep-alive\r\n"
+        "Cache-Control: max-age=0\r\n"
+        "Upgrade-Insecure-Requests: 1\r\n"
+        "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Accept-Language: en-GB,en-US;q=0.9,en;q=0.8\r\n"
+        "\r\n" },
+    { "firefox-xhr",
+        "GET /api/readings HTTP/1.1\r\n"
+        "Host: 192.168.4.1\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+        "Accept: application/json, text/plain, */*\r\n"
+        "Accept-Language: en-GB,en;q=0.5\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Connection: keep-alive\r\n"
+        "Referer: http://192.168.4.1/\r\n"
+        "\r\n" },
+    { "safari-ios",
+        "GET /style.css HTTP/1.1\r\n"
+        "Host: 192.168.4.1\r\n"
+        "Accept: text/css,*/*;q=0.1\r\n"
+        "If-None-Match: \"5f1c-2d4\"\r\n"
+        "Accept-Language: en-GB,en;q=0.9\r\n"
+        "Connection: keep-alive\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "User-Agent: Mozilla/5.0 (iPhone; CPU iPhone OS 17_1_2 like Mac OS X) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.1.2 Mobile/15E148 Safari/604.1\r\n"
+        "Referer: http://192.168.4.1/\r\n"
+        "\r\n" },
+    { "chrome-cookies",
+        "GET /api/history?sensor=2&from=1700000000&to=1700086400&step=300 HTTP/1.1\r\n"
+        "Host: 192.168.4.1\r\n"
+        "Connection: keep-alive\r\n"
+        "sec-ch-ua: \"Not_A Brand\";v=\"8\", \"Chromium\";v=\"120\", \"Google Chrome\";v=\"120\"\r\n"
+        "sec-ch-ua-mobile: ?0\r\n"
+        "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+        "sec-ch-ua-platform: \"Windows\"\r\n"
+        "Accept: */*\r\n"
+        "Sec-Fetch-Site: same-origin\r\n"
+        "Sec-Fetch-Mode: cors\r\n"
+        "Sec-Fetch-Dest: empty\r\n"
+        "Referer: http://192.168.4.1/history.html\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Accept-Language: en-GB,en-US;q=0.9,en;q=0.8\r\n"
+        "Cookie: session=6f1d2c0a9b8e7d6c5b4a39281706f5e4; theme=dark; units=metric; last_sensor=2; _ga=GA1.1.1234567890.1700000000\r\n"
+        "\r\n" },
+};
+
+static void _bench_headers(size_t concurrency, size_t requests){
+    ArRequestHandlerFunction ok = [](AsyncWebServerRequest * request){
+        request->send(200, "text/plain", "ok");
+    };
+    _server.on("/", HTTP_GET, ok);
+    _server.on("/api/readings", HTTP_GET, ok);
+    _server.on("/api/history", HTTP_GET, ok);
+    _server.on("/style.css", HTTP_GET, ok);
+    _server.begin();
+
+    _header();
+    for(const trace_t & trace : _traces){
+        phase_t phase;
+        phase.name = trace.name;
+        phase.requests.push_back(trace.request);
+        phase.check = [](size_t index, int status, const std::string & body){
+            return status == 200 && body == "ok";
+        };
+        _run(phase, concurrency, requests);
+    }
+}
+
+/*
+ * Multipart uploads
+ * */
+
+#define MULTIPART_BOUNDARY "----WebKitFormBoundary7MA4YWxkTrZu0gW"
+#define MULTIPART_NOTE "Moved the basil to the south window, soil was dry at 2cm. Watered 250ml. Next check on Friday, then compare with the readings of the second bed."
+
+//lines of text with the odd dash, as a CSV export would have
+static uint8_t _file_byte(size_t i){
+    size_t column = i % 61;
+    if(column == 59){
+        return '\r';
+    } else if(column == 60){
+        return '\n';
+    } else if(column % 13 == 12){
+        return (i / 61) % 7 ? ',' : '-';
+    }
+    return 'a' + (i * 7 + i / 251) % 26;
+}
+
+typedef struct {
+    size_t received;
+    size_t calls;
+    bool corrupt;
+    bool final;
+} upload_t;
+
+//uploads in progress, touched by the async task only
+static std::map<AsyncWebServerRequest *, upload_t> _uploads;
+static uint64_t _upload_calls = 0;
+
+static void _upload_data(AsyncWebServerRequest * request, const String & filename, size_t index, uint8_t * data, size_t len, bool final){
+    upload_t * upload;
+    {
+        HostAllocQuiet quiet;
+        upload = &_uploads[request];
+    }
+    upload->corrupt = upload->corrupt || upload->final || index != upload->received || filename != "readings.csv";
+    for(size_t i = 0; i < len; i++){
+        upload->corrupt = upload->corrupt || data[i] != _file_byte(index + i);
+    }
+    upload->received += len;
+    upload->calls++;
+    upload->final = final;
+    _upload_calls++;
+}
+
+static void _upload_done(AsyncWebServerRequest * request){
+    upload_t upload = { 0, 0, false, true };
+    {
+        HostAllocQuiet quiet;
+        auto it = _uploads.find(request);
+        if(it != _uploads.end()){
+            upload = it->second;
+            _uploads.erase(it);
+        }
+    }
+    //the size field comes before the file, a request without a file has none
+    size_t size = request->hasParam("size", true) ? request->getParam("size", true)->value().toInt() : 0;
+    bool ok = !upload.corrupt && upload.final && upload.received == size
+        && request->hasParam("sensor", true) && request->getParam("sensor", true)->value() == "2"
+        && request->hasParam("note", true) && request->getParam("note", true)->value() == MULTIPART_NOTE;
+    request->send(ok ? 200 : 400, "text/plain", ok ? "ok" : "bad");
+}
+
+static std::string _multipart_field(const char * name, const std::string & value){
+    return std::string("--" MULTIPART_BOUNDARY "\r\nContent-Disposition: form-data; name=\"") + name + "\"\r\n\r\n" + value + "\r\n";
+}
+
+//what Chrome sends for a form with a file input, without the file when size is 0
+static std::string _multipart_request(size_t size){
+    std::string body = _multipart_field("sensor", "2") + _multipart_field("note", MULTIPART_NOTE);
+    if(size){
+        body += _multipart_field("size", std::to_string(size));
+        body += "--" MULTIPART_BOUNDARY "\r\nContent-Disposition: form-data; name=\"file\"; filename=\"readings.csv\"\r\nContent-Type: text/csv\r\n\r\n";
+        for(size_t i = 0; i < size; i++){
+            body.push_back(_file_byte(i));
+        }
+        body += "\r\n";
+    }
+    body += "--" MULTIPART_BOUNDARY "--\r\n";
+    return "POST /upload HTTP/1.1\r\n"
+        "Host: 192.168.4.1\r\n"
+        "Connection: keep-alive\r\n"
+        "Content-Length: " + std::to_string(body.size()) + "\r\n"
+        "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36\r\n"
+        "Content-Type: multipart/form-data; boundary=" MULTIPART_BOUNDARY "\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Origin: http://192.168.4.1\r\n"
+        "Referer: http://192.168.4.1/upload.html\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Accept-Language: en-GB,en-US;q=0.9,en;q=0.8\r\n"
+        "\r\n" + body;
+}
+
+static void _bench_multipart(size_t concurrency, size_t requests){
+    static const struct {
+        const char * name;
+        size_t size;
+    } uploads[] = {
+        { "fields", 0 },
+        { "file-4k", 4096 },
+        { "file-64k", 65536 },
+        { "file-1m", 1048576 },
+    };
+    _server.on("/upload", HTTP_POST, _upload_done, _upload_data);
+    _server.begin();
+
+    _header();
+    for(auto & upload : uploads){
+        phase_t phase;
+        phase.name = upload.name;
+        phase.requests.push_back(_multipart_request(upload.size));
+        phase.check = [](size_t index, int status, const std::string & body){
+            return status == 200 && body == "ok";
+        };
+        //about as many bytes in every phase
+        size_t count = std::max((size_t)1, requests * 4096 / (upload.size + 4096));
+        _upload_calls = 0;
+        uint64_t us = _run(phase, std::min(concurrency, count), count);
+        double mb = (double)phase.requests[0].size() * count / 1e6;
+        printf("%-14s %.1f MB/s parsed by the server, %.1f onUpload() calls per MB\n", "", mb / (us / 1e6), upload.size ? _upload_calls / mb : 0);
+        fflush(stdout);
+    }
+}
+
+/*
+ * Routing
+ * */
+
+//the url of route i and of a request it takes
+static void _route(size_t i, String & uri, std::string & path){
+    char buf[48];
+    switch(i % 4){
+        case 0:
+            snprintf(buf, sizeof(buf), "/api/sensor/%u", (unsigned)i);
+            uri = buf;
+            path = buf;
+            break;
+        case 1:
+            snprintf(buf, sizeof(buf), "/api/sensor/%u/history", (unsigned)i);
+            uri = buf;
+            path = std::string(buf) + "?from=1700000000";
+            break;
+        case 2:
+            snprintf(buf, sizeof(buf), "/files/%u/", (unsigned)i);
+            uri = String(buf) + "*";
+            path = std::string(buf) + "log.csv";
+            break;
+        default:
+            snprintf(buf, sizeof(buf), "/page%u.html", (unsigned)i);
+            uri = buf;
+            path = buf;
+            break;
+    }
+}
+
+static void _bench_routes(size_t concurrency, size_t requests){
+    static const size_t counts[] = { 4, 32, 128, 256 };
+    _server.begin();
+
+    _header();
+    for(size_t count : counts){
+        char name[16];
+        snprintf(name, sizeof(name), "%u-routes", (unsigned)count);
+        phase_t phase;
+        phase.name = name;
+        //handlers change between phases only, no peer is connected then
+        _server.reset();
+        _server.onNotFound([](AsyncWebServerRequest * request){
+            request->send(404, "text/plain", "none");
+        });
+        for(size_t i = 0; i < count; i++){
+            String uri;
+            std::string path;
+            _route(i, uri, path);
+            _server.on(uri.c_str(), HTTP_GET, [i](AsyncWebServerRequest * request){
+                request->send(200, "text/plain", String("route ") + String((unsigned)i));
+            });
+            phase.requests.push_back("GET " + path + " HTTP/1.1\r\n"
+                "Host: 192.168.4.1\r\n"
+                "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+                "Accept: */*\r\n"
+                "\r\n");
+        }
+        phase.requests.push_back("GET /api/sensors HTTP/1.1\r\nHost: 192.168.4.1\r\nAccept: */*\r\n\r\n");
+        phase.check = [count](size_t index, int status, const std::string & body){
+            if(index == count){
+                return status == 404;
+            }
+            return status == 200 && body == "route " + std::to_string(index);
+        };
+        _run(phase, concurrency, requests);
+    }
+}
+
+/*
+ * Templates
+ * */
+
+//two placeholders a row, the page stays under ASYNC_WEB_TEMPLATE_SEGMENTS so it can be compiled
+#define TEMPLATE_ROWS 120
+
+static std::string _template_page;
+static std::string _template_expanded;
+static fs::FS _template_fs;
+
+//TEMP_n and HUM_n, values of a few lengths like real readings
+static String _template_value(const String & name){
+    int underscore = name.indexOf('_');
+    if(underscore < 0){
+        return String();
+    }
+    long n = name.substring(underscore + 1).toInt();
+    char buf[16];
+    if(name.startsWith("TEMP")){
+        snprintf(buf, sizeof(buf), "%ld.%ld", 5 + n % 30, n % 10);
+    } else {
+        snprintf(buf, sizeof(buf), "%ld", 30 + n % 70);
+    }
+    return String(buf);
+}
+
+//a table of readings per bed, two placeholders a row
+static void _build_template(){
+    std::string page = "<!DOCTYPE html><html><head><title>Beds</title><link rel=\"stylesheet\" href=\"style.css\"></head>\n"
+        "<body><h1>Beds</h1><p>Humidity in %% of saturation, temperature in &deg;C</p>\n<table>\n";
+    std::string expanded = "<!DOCTYPE html><html><head><title>Beds</title><link rel=\"stylesheet\" href=\"style.css\"></head>\n"
+        "<body><h1>Beds</h1><p>Humidity in % of saturation, temperature in &deg;C</p>\n<table>\n";
+    for(unsigned i = 0; i < TEMPLATE_ROWS; i++){
+        char row[160];
+        char temp[16];
+        char hum[16];
+        snprintf(temp, sizeof(temp), "TEMP_%u", i);
+        snprintf(hum, sizeof(hum), "HUM_%u", i);
+        snprintf(row, sizeof(row), "<tr><td>Bed %u</td><td class=\"t\">%%%s%%</td><td class=\"h\">%%%s%%</td></tr>\n", i, temp, hum);
+        page += row;
+        snprintf(row, sizeof(row), "<tr><td>Bed %u</td><td class=\"t\">%s</td><td class=\"h\">%s</td></tr>\n", i,
+            _template_value(temp).c_str(), _template_value(hum).c_str());
+        expanded += row;
+    }
+    page += "</table></body></html>\n";
+    expanded += "</table></body></html>\n";
+    _template_page = page;
+    _template_expanded = expanded;
+    fs::File file = _template_fs.open("/www/beds.html", FILE_WRITE);
+    file.write((const uint8_t *)page.data(), page.size());
+    file.close();
+}
+
+static void _bench_template(size_t concurrency, size_t requests){
+    _build_template();
+    _server.on("/beds", HTTP_GET, [](AsyncWebServerRequest * request){
+        request->send_P(200, "text/html", _template_page.c_str(), _template_value);
+    });
+    _server.serveStatic("/beds.html", _template_fs, "/www/beds.html").setTemplateProcessor(_template_value);
+    _server.begin();
+
+    static const struct {
+        const char * name;
+        const char * path;
+        size_t cache;
+    } sources[] = {
+        { "progmem", "/beds", 0 },
+        { "file", "/beds.html", 0 },
+        { "file-compiled", "/beds.html", ASYNC_WEB_TEMPLATE_CACHE },
+    };
+    _header();
+    for(auto & source : sources){
+        phase_t phase;
+        phase.name = source.name;
+        phase.requests.push_back(std::string("GET ") + source.path + " HTTP/1.1\r\n"
+            "Host: 192.168.4.1\r\n"
+            "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:109.0) Gecko/20100101 Firefox/115.0\r\n"
+            "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+            "Accept-Encoding: gzip, deflate\r\n"
+            "\r\n");
+        phase.check = [](size_t index, int status, const std::string & body){
+            return status == 200 && body == _template_expanded;
+        };
+        //no peer is connected between phases
+        _server.setTemplateCache(source.cache);
+        _run(phase, concurrency, requests);
+    }
+    printf("%-14s %u placeholders in %u bytes, %u bytes expanded\n", "", TEMPLATE_ROWS * 2, (unsigned)_template_page.size(), (unsigned)_template_expanded.size());
+    fflush(stdout);
+}
+
+/*
+ * Response framing
+ * */
+
+#define FRAMING_BODY (TCP_SND_BUF * 3 + 1234)
+
+static uint8_t _framing_byte(size_t i){
+    return 'a' + (i * 7 + i / 251) % 26;
+}
+
+//fills as much as it is asked for, the body ends when it returns 0
+static size_t _framing_fill(uint8_t * data, size_t len, size_t index){
+    size_t n = (index < FRAMING_BODY) ? std::min(len, (size_t)FRAMING_BODY - index) : 0;
+    for(size_t i = 0; i < n; i++){
+        data[i] = _framing_byte(index + i);
+    }
+    return n;
+}
+
+static void _bench_framing(size_t concurrency, size_t requests){
+    _server.on("/length", HTTP_GET, [](AsyncWebServerRequest * request){
+        request->send("application/octet-stream", FRAMING_BODY, _framing_fill);
+    });
+    _server.on("/chunked", HTTP_GET, [](AsyncWebServerRequest * request){
+        request->sendChunked("application/octet-stream", _framing_fill);
+    });
+    //no length and no chunks, the server closes the connection after the body
+    _server.on("/to-close", HTTP_GET, [](AsyncWebServerRequest * request){
+        request->send("application/octet-stream", 0, _framing_fill);
+    });
+    _server.begin();
+
+    std::string expected;
+    for(size_t i = 0; i < FRAMING_BODY; i++){
+        expected.push_back(_framing_byte(i));
+    }
+    static const char * paths[] = { "/length", "/chunked", "/to-close" };
+    _header();
+    for(const char * path : paths){
+        phase_t phase;
+        phase.name = path + 1;
+        phase.requests.push_back(std::string("GET ") + path + " HTTP/1.1\r\n"
+            "Host: 192.168.4.1\r\n"
+            "Accept: */*\r\n"
+            "\r\n");
+        phase.check = [&expected](size_t index, int status, const std::string & body){
+            return status == 200 && body == expected;
+        };
+        _run(phase, concurrency, requests);
+    }
+}
+
+int main(int argc, char ** argv){
+    size_t concurrency = 8;
+    size_t requests = 20000;
+    const char * bench = (argc > 1) ? argv[1] : "";
+    int opt;
+    optind = 2;
+    while((opt = getopt(argc, argv, "c:n:")) != -1){
+        switch(opt){
+            case 'c': concurrency = strtoul(optarg, NULL, 0); break;
+            case 'n': requests = strtoul(optarg, NULL, 0); break;
+            default: bench = ""; break;
+        }
+    }
+    if(concurrency > requests){
+        concurrency = requests;
+    }
+    if(!strcmp(bench, "headers")){
+        _bench_headers(concurrency, requests);
+    } else if(!strcmp(bench, "multipart")){
+        _bench_multipart(concurrency, requests);
+    } else if(!strcmp(bench, "routes")){
+        _bench_routes(concurrency, requests);
+    } else if(!strcmp(bench, "template")){
+        _bench_template(concurrency, requests);
+    } else if(!strcmp(bench, "framing")){
+        _bench_framing(concurrency, requests);
+    } else {
+        fprintf(stderr, "usage: %s headers|multipart|routes|template|framing [-c connections] [-n requests per phase]\n", argv[0]);
+        return 2;
+    }
+    //the async task and the stack thread never return
+    _Exit(_errors ? 1 : 0);
+}